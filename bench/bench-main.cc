@@ -0,0 +1,254 @@
+/*
+ * bench-main.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "parser/parser.h"
+
+//=====----------------------------------------------------------------------======//
+//      Allocation Counting
+//=====----------------------------------------------------------------------======//
+
+namespace {
+
+std::size_t allocations = 0;
+std::size_t allocated_bytes = 0;
+
+}
+
+void *
+operator new(std::size_t size) {
+   ++allocations;
+   allocated_bytes += size;
+
+   if (auto p = std::malloc(size ? size : 1)) {
+      return p;
+   }
+
+   throw std::bad_alloc();
+}
+
+void
+operator delete(void *p) noexcept {
+   std::free(p);
+}
+
+namespace {
+
+//=====----------------------------------------------------------------------======//
+//      Corpora
+//=====----------------------------------------------------------------------======//
+
+/** Synthetic input for the front end. */
+struct corpus {
+   std::string name;
+   std::string text;
+
+   /** The number of literals, identifiers, operators and parentheses. */
+   std::size_t tokens;
+};
+
+/** Long lines of literals joined by every kind of operator. */
+auto
+flat_expressions(std::size_t lines, std::size_t terms) -> corpus {
+   static const char *ops[] = { " + ", " - ", " * ", " / ", " % ", " << ", " >> ", " & ", " | ", " ^ " };
+
+   corpus c = { "flat", std::string(), 0 };
+   for (std::size_t l = 0; l < lines; ++l) {
+      for (std::size_t t = 0; t < terms; ++t) {
+         if (t > 0) {
+            c.text += ops[(l + t) % 10];
+            ++c.tokens;
+         }
+
+         c.text += std::to_string(1 + (l * terms + t) % 1000);
+         ++c.tokens;
+      }
+
+      c.text += '\n';
+   }
+
+   return c;
+}
+
+/** Lines which nest parenthetical groups deeply. */
+auto
+nested_groups(std::size_t lines, std::size_t depth) -> corpus {
+   corpus c = { "nested", std::string(), 0 };
+   for (std::size_t l = 0; l < lines; ++l) {
+      for (std::size_t d = 0; d < depth; ++d) {
+         c.text += "(" + std::to_string(d % 100) + " + ";
+         c.tokens += 3;
+      }
+
+      c.text += "1";
+      ++c.tokens;
+
+      c.text += std::string(depth, ')') + '\n';
+      c.tokens += depth;
+   }
+
+   return c;
+}
+
+/** Lines which mention many distinct identifiers, each declared on a line
+ * of its own before it is used. */
+auto
+many_identifiers(std::size_t lines, std::size_t terms) -> corpus {
+   corpus c = { "identifiers", std::string(), 0 };
+   for (std::size_t l = 0; l < lines; ++l) {
+      std::string sum;
+      for (std::size_t t = 0; t < terms; ++t) {
+         auto name = "value_" + std::to_string(l) + "_" + std::to_string(t);
+         c.text += name + " := 1\n";
+         c.tokens += 3;
+
+         if (t > 0) {
+            sum += " + ";
+            ++c.tokens;
+         }
+
+         sum += name;
+         ++c.tokens;
+      }
+
+      c.text += sum + '\n';
+   }
+
+   return c;
+}
+
+/** One := initialization per line. */
+auto
+initializations(std::size_t lines) -> corpus {
+   corpus c = { "initializations", std::string(), 0 };
+   for (std::size_t l = 0; l < lines; ++l) {
+      c.text += "variable_" + std::to_string(l) + " := " + std::to_string(l % 100000) + "\n";
+      c.tokens += 3;
+   }
+
+   return c;
+}
+
+//=====----------------------------------------------------------------------======//
+//      Measurement
+//=====----------------------------------------------------------------------======//
+
+/** The best of several runs of one phase. */
+struct measurement {
+   double seconds;
+   std::size_t allocations;
+   std::size_t bytes;
+};
+
+/**
+ * Runs setup and then phase until at least min_runs runs and half a
+ * second have gone by. Only phase is timed, and the fastest run is kept,
+ * since it is the one least disturbed by the rest of the machine.
+ */
+auto
+measure(const std::function<void()> &setup, const std::function<void()> &phase) -> measurement {
+   const std::size_t min_runs = 3;
+   const double min_total = 0.5;
+
+   measurement best = { 0, 0, 0 };
+   double total = 0;
+
+   for (std::size_t run = 0; run < min_runs || total < min_total; ++run) {
+      setup();
+
+      auto a = allocations;
+      auto b = allocated_bytes;
+      auto start = std::chrono::steady_clock::now();
+
+      phase();
+
+      auto end = std::chrono::steady_clock::now();
+      double seconds = std::chrono::duration<double>(end - start).count();
+
+      if (run == 0 || seconds < best.seconds) {
+         best.seconds = seconds;
+         best.allocations = allocations - a;
+         best.bytes = allocated_bytes - b;
+      }
+
+      total += seconds;
+   }
+
+   return best;
+}
+
+void
+report(const corpus &c, const char *phase, const measurement &m) {
+   double mb = c.text.size() / (1024.0 * 1024.0);
+
+   std::printf("%-16s %-14s %10.2f %12.2f %12.0f %12.2f %12.1f\n",
+               c.name.c_str(), phase,
+               mb / m.seconds,
+               c.tokens / m.seconds / 1e6,
+               double(m.allocations),
+               double(m.allocations) / c.tokens,
+               double(m.bytes) / c.tokens);
+}
+
+void
+bench(const corpus &c) {
+   amalgam::parser::parser p;
+   amalgam::parser::module_ptr_t m;
+   auto nothing = []() {};
+
+   report(c, "parse", measure(nothing, [&]() {
+      m = p.parse_unverified(c.text);
+   }));
+
+   // Verification annotates the tree, so each run gets a fresh one.
+   report(c, "verify", measure([&]() {
+      m = p.parse_unverified(c.text);
+   }, [&]() {
+      amalgam::parser::verifier v;
+      if (!v.verify(m)) {
+         std::printf("error: the %s corpus failed to verify\n", c.name.c_str());
+      }
+   }));
+
+   report(c, "parse+verify", measure([&]() {
+      m = nullptr;
+   }, [&]() {
+      m = p.parse(c.text);
+   }));
+}
+
+}
+
+int main(int argc, char **argv) {
+   // An optional argument scales the size of every corpus.
+   std::size_t scale = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1;
+   if (scale == 0) {
+      scale = 1;
+   }
+
+   std::vector<corpus> corpora = {
+      flat_expressions(200 * scale, 500),
+      nested_groups(200 * scale, 200),
+      many_identifiers(200 * scale, 200),
+      initializations(50000 * scale)
+   };
+
+   std::printf("%-16s %-14s %10s %12s %12s %12s %12s\n",
+               "corpus", "phase", "MB/s", "Mtokens/s", "allocs", "allocs/tok", "bytes/tok");
+
+   for (auto &c : corpora) {
+      bench(c);
+   }
+
+   return 0;
+}
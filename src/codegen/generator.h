@@ -31,7 +31,7 @@ class generator {
 
    typedef std::function<llvm::Value * (llvm::Value *, llvm::Value *)> bin_op_gen_t;
 
-   typedef std::map<std::string, bin_op_gen_t> op_map_t;
+   typedef std::map<parser::symbol_t, bin_op_gen_t> op_map_t;
 
    llvm::LLVMContext &ctx;
    llvm::Module *cm;
@@ -51,26 +51,23 @@ class generator {
    /** This points to the method currently being processed. */
    parser::method_ptr_t current_method;
 
+   /** Gets the token text of a node. */
    auto
-   constant_int(parser::ast_ptr_t i) -> llvm::Value * {
-      return llvm::ConstantInt::get(ctx,
-                                    llvm::APInt(64, std::stoi(i->data), true));
+   get_text(const parser::flat_tree &t, parser::node_index_t n) -> const std::string & {
+      return current_module->get_symbols()->name(t.symbol(n));
    }
 
    auto
-   bin_op(parser::ast_ptr_t op) -> llvm::Value * {
-      auto left = get_value(op->children[0]);
-      auto right = get_value(op->children[1]);
-
-      if (left==nullptr || right==nullptr) {
-         std::cout << "internal error: binary operation expected two operands, but did not find them." << std::endl;
-
-         return nullptr;
-      }
+   constant_int(const parser::flat_tree &t, parser::node_index_t i) -> llvm::Value * {
+      return llvm::ConstantInt::get(ctx,
+                                    llvm::APInt(64, t.literal(i).bits, t.literal(i).is_signed));
+   }
 
-      auto it = op_map.find(op->data);
+   auto
+   bin_op(const parser::flat_tree &t, parser::node_index_t op, llvm::Value *left, llvm::Value *right) -> llvm::Value * {
+      auto it = op_map.find(t.symbol(op));
       if (it==op_map.end()) {
-         std::cout << "internal error: no generator found for '" << op->data << "'." << std::endl;
+         std::cout << "internal error: no generator found for '" << get_text(t, op) << "'." << std::endl;
 
          return nullptr;
       }
@@ -82,20 +79,50 @@ class generator {
       return op_gen(left,right);
    }
 
+   /** Generates code for the tree under n. The subtree is swept backwards, so
+    * each node finds the values of its children on top of the stack, the left
+    * operand above the right one. */
    auto
-   get_value(parser::ast_ptr_t n) -> llvm::Value * {
-      switch (n->type) {
-         default:
-            std::cout << "internal error: no processor found for node type '" << (int)n->type << "':'" << n->data << "'" << std::endl;
-            return nullptr;
-
-         case parser::node_type::literal_int:
-            return constant_int(n);
-         case parser::node_type::op:
-            return bin_op(n);
-         case parser::node_type::group:
-            return get_value(n->children[0]);
+   get_value(const parser::flat_tree &t, parser::node_index_t n) -> llvm::Value * {
+      std::vector<llvm::Value *> values;
+
+      for (auto i = t.next_sibling(n); i-- > n;) {
+         switch (t.type(i)) {
+            default:
+               std::cout << "internal error: no processor found for node type '" << (int)t.type(i) << "':'" << get_text(t, i) << "'" << std::endl;
+               return nullptr;
+
+            case parser::node_type::literal_int:
+               values.push_back(constant_int(t, i));
+               break;
+
+            case parser::node_type::op: {
+               if (values.size() < 2) {
+                  std::cout << "internal error: binary operation expected two operands, but did not find them." << std::endl;
+
+                  return nullptr;
+               }
+
+               auto left = values.back();
+               values.pop_back();
+
+               auto value = bin_op(t, i, left, values.back());
+               if (value==nullptr) {
+                  return nullptr;
+               }
+
+               values.back() = value;
+               break;
+            }
+
+            case parser::node_type::group:
+               // The value of a group is the value of its child, which is
+               // already on the stack.
+               break;
+         }
       }
+
+      return values.empty() ? nullptr : values.back();
    }
 
    void
@@ -117,8 +144,10 @@ class generator {
 
       builder.SetInsertPoint(method_entry_bb);
 
-      for (auto expr : m->get_expression_tree_list()) {
-         auto value = get_value(expr); // We discard the value because these are
+      auto &tree = m->get_flat_tree();
+
+      for (auto expr : tree.get_roots()) {
+         auto value = get_value(tree, expr); // We discard the value because these are
                                        // statements. Eventually we will generate code
                                        // for functional-like methods.
 
@@ -147,24 +176,24 @@ public:
 
       op_map = {
          // Simple integer
-         { "+",  BINOPGEN(Add)  },
-         { "-",  BINOPGEN(Sub)  },
-         { "*",  BINOPGEN(Mul)  },
-         { "/",  BINOPGEN(SDiv) },
-         { "%",  BINOPGEN(SRem) },
-         { "&",  BINOPGEN(And)  },
-         { "|",  BINOPGEN(Or)   },
-         { "^",  BINOPGEN(Xor)  },
-         { "<<", BINOPGEN(Shl)  },
-         { ">>", BINOPGEN(LShr) },
+         { parser::builtin_symbol::add,      BINOPGEN(Add)  },
+         { parser::builtin_symbol::sub,      BINOPGEN(Sub)  },
+         { parser::builtin_symbol::mul,      BINOPGEN(Mul)  },
+         { parser::builtin_symbol::div,      BINOPGEN(SDiv) },
+         { parser::builtin_symbol::rem,      BINOPGEN(SRem) },
+         { parser::builtin_symbol::bit_and,  BINOPGEN(And)  },
+         { parser::builtin_symbol::bit_or,   BINOPGEN(Or)   },
+         { parser::builtin_symbol::bit_xor,  BINOPGEN(Xor)  },
+         { parser::builtin_symbol::shl,      BINOPGEN(Shl)  },
+         { parser::builtin_symbol::shr,      BINOPGEN(LShr) },
 
          // Comparison
-         { ">=", BINOPGEN(ICmpSGE) },
-         { "<=", BINOPGEN(ICmpSLE) },
-         { "==", BINOPGEN(ICmpEQ)  },
-         { "!=", BINOPGEN(ICmpNE)  },
-         { "<",  BINOPGEN(ICmpSLT) },
-         { ">",  BINOPGEN(ICmpSGT) }
+         { parser::builtin_symbol::ge,       BINOPGEN(ICmpSGE) },
+         { parser::builtin_symbol::le,       BINOPGEN(ICmpSLE) },
+         { parser::builtin_symbol::eq,       BINOPGEN(ICmpEQ)  },
+         { parser::builtin_symbol::ne,       BINOPGEN(ICmpNE)  },
+         { parser::builtin_symbol::lt,       BINOPGEN(ICmpSLT) },
+         { parser::builtin_symbol::gt,       BINOPGEN(ICmpSGT) }
       };
 
 #undef BINOPGEN
@@ -5,13 +5,92 @@
  *      Author: Christopher Nelson
  */
 
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
 #include <readline/readline.h>
+#include <unistd.h>
 
 #include "parser/parser.h"
 #include "codegen/generator.h"
 
+/** Finds the library directory, which holds lib/syntax and the modules
+ * imports fall back to. It is the lib directory next to the executable,
+ * unless AMALGAM_LIB names another, so that it does not matter where the
+ * compiler is run from. */
+static std::string library_directory() {
+    if (auto dir = std::getenv("AMALGAM_LIB")) {
+        return dir;
+    }
+
+    char path[PATH_MAX];
+    auto length = readlink("/proc/self/exe", path, sizeof(path));
+    if (length <= 0) {
+        return "lib";
+    }
+
+    std::string exe(path, length);
+    return exe.substr(0, exe.rfind('/') + 1) + "lib";
+}
+
 int main(int argc, char **argv) {
 
+    auto lib = library_directory();
+
+    // Load the operator and statement forms once. The compiled tables are
+    // cached next to the declarations, so this is cheap after the first run.
+    auto syntax = amalgam::parser::syntax_table::load_directory(lib + "/syntax", lib + "/syntax/syntax.cache");
+
+    // If we were given a file, compile and run it instead of starting
+    // the interactive loop. With --profile, also report how much work
+    // each grammar rule did on it.
+    if (argc > 1) {
+        amalgam::parser::parser p(syntax);
+
+        auto profile = argc > 2 && std::string(argv[1]) == "--profile";
+        if (profile) {
+            p.set_profiling(&std::cerr);
+        }
+
+        // Report every syntax error in the file, not just the first.
+        p.set_recovery(true);
+
+        // Imports which are not next to the file come from the library.
+        p.set_search_path({ lib });
+
+        // Methods are verified independently, so use every core.
+        p.set_verification_threads(0);
+
+        auto module = p.parse_file(argv[profile ? 2 : 1]);
+        if (nullptr == module || module->has_diagnostics()) return 1;
+
+        amalgam::codegen::generator g;
+
+        g.generate(module);
+        g.run();
+
+        return 0;
+    }
+
+    // If the input is piped in, compile and run each statement as soon as
+    // it arrives rather than reading everything first.
+    if (!isatty(STDIN_FILENO)) {
+        amalgam::parser::parser p(syntax);
+
+        p.parse_stream(std::cin, [](amalgam::parser::module_ptr_t module) {
+            if (nullptr == module) return;
+
+            amalgam::codegen::generator g;
+
+            g.generate(module);
+            g.run();
+        });
+
+        return 0;
+    }
+
     while(true) {
     
         auto input = readline("] ");
@@ -19,7 +98,7 @@ int main(int argc, char **argv) {
         // If we got EOF, stop looping.
         if (nullptr == input) break;
 
-        amalgam::parser::parser p;
+        amalgam::parser::parser p(syntax);
 
         auto module = p.parse(input, true);
 
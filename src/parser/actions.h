@@ -11,6 +11,7 @@
 #include <vector>
 
 #include "pegtl.hh"
+#include "expression_builder.h"
 #include "module.h"
 
 namespace amalgam {
@@ -18,83 +19,44 @@ namespace parser {
 
 using namespace pegtl;
 
-/**
- * This type represents a stack of ast trees. As we
- * recognize input, nodes will be pushed onto
- * the stack. Some nodes will pop items off of the
- * stack and internalize them, then replace the top
- * of the stack with itself.
- */
-typedef std::vector<ast_ptr_t> ast_stack_t;
-
-/**
- * This action is performed when basic expression elements are recognized. It
- * is used to build up a parse tree of the expressions.
- */
-template<node_type nt>
-   struct push_node : action_base<push_node<nt> > {
-      static void
-      apply(const std::string &s, ast_stack_t &t, module_ptr_t m) {
-         auto n = make_ast();
-
-         n->type = nt;
-         n->data = s;
-
-         switch (nt) {
-            default:
-               t.push_back(n);
-               break;
-
-            case node_type::op:
-               if (t.size() > 0 && t.back()->type == node_type::literal_int) {
-                  // If the top of the stack is a literal or identifier, swap
-            	  // places with it.
-                  auto top = t.back();
-
-                  t.pop_back();
-                  t.push_back(n);
-                  t.push_back(top);
-               } else {
-                  t.push_back(n);
-               }
-               break;
-         } // end switch
-      } // end apply
-   };
+/** Allocates a node for the token which starts at offset. */
+inline auto
+make_node(node_type nt, uint64_t offset, std::size_t length, symbol_t symbol, module_ptr_t m) -> ast_ptr_t {
+   auto n = m->make_ast();
 
-struct sweep_expression_tree : action_base<sweep_expression_tree> {
-   static auto
-   to_tree(ast_stack_t::iterator& it) -> ast_ptr_t {
-      auto node = *it;
+   n->type = nt;
+   n->start_pos = offset;
+   n->end_pos = offset + length;
+   n->symbol = symbol;
 
-      switch (node->type) {
-         default:
-            break;
+   return n;
+}
 
-         case node_type::op:
-            node->children.push_back(to_tree(++it));
-            node->children.push_back(to_tree(++it));
-            break;
-      }
-
-      return node;
+/** Performed when a parenthetical group is opened. */
+struct open_group : action_base<open_group> {
+   static void
+   apply(const match_view& v, expression_builder& b, module_ptr_t m) {
+      b.open_group();
    }
+};
 
+/** Performed when a parenthetical group is closed. */
+struct close_group : action_base<close_group> {
    static void
-   apply(const std::string& s, ast_stack_t& t, module_ptr_t m) {
-      // We are at the end of the expression list specified in the file. We sweep
-      // the contents of the top of the stack into the current method's expression
-      // lists.
+   apply(const match_view& v, expression_builder& b, module_ptr_t m) {
+      b.close_group();
+   }
+};
 
-      if (t.size() > 0) {
-         /*std::cout << "trace: parse stack:" << std::endl;
-         for (auto n : t) {
-            std::cout << (int) (n->type) << ": " << n->data << std::endl;
-         }*/
+struct finish_expression : action_base<finish_expression> {
+   static void
+   apply(const match_view& v, expression_builder& b, module_ptr_t m) {
+      // We are at the end of the expression list specified in the file. The
+      // completed tree goes into the current method's expression list.
+      auto tree = b.finish();
 
-         // sweep the stack recursively
-         auto it = t.begin();
-         m->get_current_method()->add_expression_tree(to_tree(it));
+      if (tree) {
+         m->get_current_method()->add_expression_tree(tree);
       }
    }
 };
@@ -0,0 +1,93 @@
+/*
+ * arena.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace amalgam {
+namespace parser {
+
+/**
+ * A bump allocator for objects which all share the lifetime of their
+ * owner. Objects are constructed in fixed-size chunks and are never
+ * freed individually. When the arena is cleared or destroyed every
+ * object it handed out is destroyed, and the chunks are released.
+ *
+ * Pointers handed out by the arena remain valid until the arena is
+ * cleared, since chunks are never moved.
+ */
+template<typename T, std::size_t ChunkSize = 512>
+class arena {
+   /** The list of storage chunks. Only the last one has free slots. */
+   std::vector<T *> chunks;
+
+   /** The number of slots used in the last chunk. */
+   std::size_t used;
+
+   arena(const arena &);
+   void operator=(const arena &);
+
+   void
+   grow() {
+      chunks.push_back(static_cast<T *>(::operator new(sizeof(T) * ChunkSize)));
+      used = 0;
+   }
+
+public:
+   arena() :
+            used(ChunkSize) {
+   }
+
+   ~arena() {
+      clear();
+   }
+
+   /** Constructs a new object in the arena and returns a handle to it.
+    * The handle does not own the object. */
+   T *
+   make() {
+      if (used == ChunkSize) {
+         grow();
+      }
+
+      auto p = new (chunks.back() + used) T();
+      ++used;
+
+      return p;
+   }
+
+   /** The number of live objects in the arena. */
+   auto
+   size() const -> std::size_t {
+      return chunks.empty() ? 0 : (chunks.size() - 1) * ChunkSize + used;
+   }
+
+   /** Destroys all objects in the arena and releases its storage. */
+   void
+   clear() {
+      for (std::size_t i = 0; i < chunks.size(); ++i) {
+         auto count = (i + 1 == chunks.size()) ? used : ChunkSize;
+
+         for (std::size_t j = 0; j < count; ++j) {
+            chunks[i][j].~T();
+         }
+
+         ::operator delete(chunks[i]);
+      }
+
+      chunks.clear();
+      used = ChunkSize;
+   }
+};
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* ARENA_H_ */
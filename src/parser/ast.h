@@ -11,21 +11,28 @@
 #include <memory>
 #include <vector>
 
-#include "annotations.h"
+#include "arena.h"
+#include "literals.h"
+#include "symbols.h"
 
 namespace amalgam {
 namespace parser {
 
-enum class node_type {
+enum class node_type : uint8_t {
     literal_int,
     identifier,
     op,
-    group
+    group,
+
+    /** A statement declared in lib/syntax. The symbol is its leading
+     * keyword, and the children are its operands and blocks in order. */
+    statement
 };
 
 struct ast;
-/** The type for shared pointers to AST nodes. */
-typedef std::shared_ptr<ast> ast_ptr_t;
+/** The type for handles to AST nodes. Nodes are owned by the arena of the
+ * module they were parsed into, so handles must not outlive the module. */
+typedef ast *ast_ptr_t;
 
 /** The type for lists of AST nodes. */
 typedef std::vector<ast_ptr_t> ast_list_t;
@@ -41,19 +48,18 @@ struct ast {
     /** Where the node ends in the input stream. */    
     uint64_t end_pos;
                 
-    /** Associated string data (if any) */
-    string data;
+    /** The interned token text (if any) */
+    symbol_t symbol;
+
+    /** The decoded value, for integer literals. */
+    literal_value literal;
 
     /** List of children (if any) */
     ast_list_t children;
-
-    /** Provides the semantic type of the node. Ie, int, string, etc. */
-    type_annotation::ptr_t semantic_type;
 };
 
-ast_ptr_t make_ast() {
-   return ast_ptr_t(new ast());
-}
+/** The type for arenas which own AST nodes. */
+typedef arena<ast> ast_arena_t;
 
 } // end parser namespace
 } // end amalgam namespace
@@ -0,0 +1,124 @@
+/*
+ * binary_io.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef BINARY_IO_H_
+#define BINARY_IO_H_
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+#include "types.h"
+
+namespace amalgam {
+namespace parser {
+
+// Helpers for the binary files the front end keeps next to sources, such
+// as cached trees and module interfaces. Values are written in the byte
+// order of the machine, since the files are never shared between machines.
+
+template<typename T>
+   void
+   write_binary(std::ostream &out, T value) {
+      out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+   }
+
+inline void
+write_binary_string(std::ostream &out, const string &s) {
+   write_binary(out, uint32_t(s.size()));
+   out.write(s.data(), s.size());
+}
+
+/** Reads values out of a file which is mapped into memory. */
+struct binary_reader {
+   const char *run;
+   const char *end;
+
+   template<typename T>
+      auto
+      read(T &value) -> bool {
+         return read_array(&value, 1);
+      }
+
+   /** Values are copied, since the file has no alignment. */
+   template<typename T>
+      auto
+      read_array(T *values, std::size_t count) -> bool {
+         if (std::size_t(end - run) < sizeof(T) * count) {
+            return false;
+         }
+
+         std::memcpy(values, run, sizeof(T) * count);
+         run += sizeof(T) * count;
+
+         return true;
+      }
+
+   auto
+   read_string(string &s) -> bool {
+      uint32_t length;
+      if (!read(length) || std::size_t(end - run) < length) {
+         return false;
+      }
+
+      s.assign(run, length);
+      run += length;
+
+      return true;
+   }
+
+   /** Reads a four character tag, a version and a hash, and checks that
+    * they are the ones expected. */
+   auto
+   read_header(const char *tag, uint32_t version, uint64_t hash) -> bool {
+      uint32_t v;
+      uint64_t h;
+
+      if (std::size_t(end - run) < 4 || std::memcmp(run, tag, 4) != 0) {
+         return false;
+      }
+
+      run += 4;
+      return read(v) && v == version && read(h) && h == hash;
+   }
+};
+
+/** Writes the header read_header() checks. */
+inline void
+write_binary_header(std::ostream &out, const char *tag, uint32_t version, uint64_t hash) {
+   out.write(tag, 4);
+   write_binary(out, version);
+   write_binary(out, hash);
+}
+
+/** Writes a file by handing a stream to write(). Returns false if the
+ * file could not be written. The file is written under another name and
+ * then renamed, so that a parse which is interrupted, or runs alongside
+ * another, never leaves half a file at path. */
+template<typename Writer>
+   auto
+   save_binary_file(const string &path, Writer write) -> bool {
+      auto temporary = path + "." + std::to_string(getpid()) + ".tmp";
+
+      std::ofstream out(temporary.c_str(), std::ios::binary);
+      write(out);
+      out.close();
+
+      if (!out || std::rename(temporary.c_str(), path.c_str()) != 0) {
+         std::remove(temporary.c_str());
+         return false;
+      }
+
+      return true;
+   }
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* BINARY_IO_H_ */
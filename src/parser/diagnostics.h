@@ -0,0 +1,48 @@
+/*
+ * diagnostics.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef DIAGNOSTICS_H_
+#define DIAGNOSTICS_H_
+
+#include <vector>
+
+#include "pegtl.hh"
+#include "types.h"
+
+namespace amalgam {
+namespace parser {
+
+/** A problem found in the source, such as a syntax error. */
+struct diagnostic {
+   /** Where the problem is in the input stream. */
+   uint64_t offset;
+
+   /** The line and column of offset, both counted from one. These are
+    * zero when the position could not be worked out, as happens for
+    * streamed input which is no longer in memory. */
+   std::size_t line;
+   std::size_t column;
+
+   /** What is wrong. */
+   string message;
+};
+
+/** The type for lists of diagnostics. */
+typedef std::vector<diagnostic> diagnostic_list_t;
+
+/** A syntax error which knows where in the input it was found. */
+struct syntax_error : public pegtl::parse_error {
+   uint64_t offset;
+
+   syntax_error(uint64_t _offset, const string &message) :
+            pegtl::parse_error(message), offset(_offset) {
+   }
+};
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* DIAGNOSTICS_H_ */
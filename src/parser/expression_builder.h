@@ -0,0 +1,245 @@
+/*
+ * expression_builder.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef EXPRESSION_BUILDER_H_
+#define EXPRESSION_BUILDER_H_
+
+#include <vector>
+
+#include "ast.h"
+#include "syntax.h"
+
+namespace amalgam {
+namespace parser {
+
+/**
+ * Builds expression trees in a single pass as operands and operators are
+ * recognized, using precedence climbing over an explicit stack. An
+ * operator is only attached to its operands once every operator which
+ * binds more tightly has been, so the tree comes out right without any
+ * reshuffling or recursion.
+ */
+class expression_builder {
+   /** Where an open parenthetical group starts on each stack. */
+   struct group {
+      std::size_t operands;
+      std::size_t operators;
+   };
+
+   const syntax_table &syntax;
+
+   const operator_table &table;
+
+   /** Operands which have not yet been attached to an operator. */
+   ast_list_t operands;
+
+   /** Operators which are still waiting for their right hand side. */
+   ast_list_t operators;
+
+   /** The parenthetical groups which are open. */
+   std::vector<group> groups;
+
+   /** What one call to reduce() did, so that rewind() can undo it. */
+   struct reduction {
+      ast_ptr_t op;
+      ast_ptr_t left;
+      ast_ptr_t right;
+
+      /** Where the left operand was on its stack, and the operator went. */
+      std::size_t operand;
+
+      /** Where the operator was on its stack. */
+      std::size_t position;
+   };
+
+   /** The reductions made since the expression was started. */
+   std::vector<reduction> reductions;
+
+   auto
+   operator_base() const -> std::size_t {
+      return groups.empty() ? 0 : groups.back().operators;
+   }
+
+   /** Attaches the operator on top of the stack to its two operands.
+    * Operators declared with operands in the middle, like
+    * () if () else (), already hold those, so the outer two go around
+    * them. */
+   void
+   reduce() {
+      auto op = operators.back();
+      operators.pop_back();
+
+      auto right = operands.back();
+      operands.pop_back();
+
+      reduction r = { op, operands.back(), right, operands.size() - 1, operators.size() };
+      reductions.push_back(r);
+
+      op->children.insert(op->children.begin(), operands.back());
+      op->children.push_back(right);
+
+      operands.back() = op;
+   }
+
+   /** Reduces every operator in the innermost group. */
+   void
+   reduce_group() {
+      auto base = operator_base();
+
+      while (operators.size() > base) {
+         reduce();
+      }
+   }
+
+public:
+   /** Records how far the builder has got, so that a failed attempt to
+    * match a syntax form can be undone. */
+   struct mark {
+      std::size_t operands;
+      std::size_t operators;
+      std::size_t groups;
+      std::size_t reductions;
+   };
+
+   expression_builder(const syntax_table &_syntax) :
+            syntax(_syntax), table(_syntax.get_operators()) {
+   }
+
+   /** The syntax forms this builder knows about. */
+   auto
+   get_syntax() const -> const syntax_table & {
+      return syntax;
+   }
+
+   /** The operators this builder knows about. */
+   auto
+   get_operators() const -> const operator_table & {
+      return table;
+   }
+
+   /** Adds a literal or identifier. */
+   void
+   operand(ast_ptr_t n) {
+      operands.push_back(n);
+   }
+
+   /** Gets the operand added last. */
+   auto
+   last_operand() const -> ast_ptr_t {
+      return operands.back();
+   }
+
+   /** Adds a binary operator. Every pending operator which binds at least
+    * as tightly is attached to its operands first. */
+   void
+   binary_operator(ast_ptr_t op) {
+      auto &info = table.get(op->symbol);
+      auto base = operator_base();
+
+      while (operators.size() > base) {
+         auto &top = table.get(operators.back()->symbol);
+
+         if (top.precedence > info.precedence
+             || (top.precedence == info.precedence && info.assoc == associativity::left)) {
+            reduce();
+         } else {
+            break;
+         }
+      }
+
+      operators.push_back(op);
+   }
+
+   /** Starts a parenthetical group. */
+   void
+   open_group() {
+      group g = { operands.size(), operators.size() };
+      groups.push_back(g);
+   }
+
+   /** Ends a parenthetical group, leaving its value as a single operand. */
+   void
+   close_group() {
+      reduce_group();
+      groups.pop_back();
+   }
+
+   /** Ends a parenthetical group and takes its value off the operand
+    * stack, so that it can be attached to a syntax form. Returns nullptr
+    * if the group was empty. */
+   auto
+   finish_group() -> ast_ptr_t {
+      auto first = groups.back().operands;
+      close_group();
+
+      if (operands.size() == first) {
+         return nullptr;
+      }
+
+      auto tree = operands.back();
+      operands.pop_back();
+
+      return tree;
+   }
+
+   /** Gets a mark for the current state. */
+   auto
+   get_mark() const -> mark {
+      mark m = { operands.size(), operators.size(), groups.size(), reductions.size() };
+      return m;
+   }
+
+   /** Undoes everything added since the mark was taken. Operators which
+    * were pending at the mark, and were attached since, are detached and
+    * put back on the stack. Operators added since the mark keep their
+    * operands, since memo<> may still replay the trees they are part of.
+    * A mark has to be rewound before the group it was taken in is closed. */
+   void
+   rewind(const mark &m) {
+      operands.resize(m.operands);
+      operators.resize(m.operators);
+      groups.resize(m.groups);
+
+      while (reductions.size() > m.reductions) {
+         auto &r = reductions.back();
+
+         if (r.position < m.operators) {
+            r.op->children.erase(r.op->children.begin());
+            r.op->children.pop_back();
+            operators[r.position] = r.op;
+         }
+
+         if (r.operand < m.operands) {
+            operands[r.operand] = r.left;
+         }
+
+         if (r.operand + 1 < m.operands) {
+            operands[r.operand + 1] = r.right;
+         }
+
+         reductions.pop_back();
+      }
+   }
+
+   /** Completes the expression and returns its tree, or nullptr if the
+    * expression was empty. The builder is ready for the next one. */
+   auto
+   finish() -> ast_ptr_t {
+      groups.clear();
+      reduce_group();
+
+      auto tree = operands.empty() ? nullptr : operands.back();
+      operands.clear();
+      reductions.clear();
+
+      return tree;
+   }
+};
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* EXPRESSION_BUILDER_H_ */
@@ -0,0 +1,198 @@
+/*
+ * flat_tree.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef FLAT_TREE_H_
+#define FLAT_TREE_H_
+
+#include <vector>
+
+#include "annotations.h"
+#include "ast.h"
+
+namespace amalgam {
+namespace parser {
+
+/** The type for indexes of nodes in a flat_tree. */
+typedef uint32_t node_index_t;
+
+/**
+ * The expression trees of a method, stored as arrays indexed by node
+ * rather than as nodes which point at each other. Nodes are stored in
+ * pre-order, so the first child of a node comes right after it, and the
+ * whole subtree of a node is one contiguous range. Passes walk trees by
+ * sweeping over that range: forwards to visit parents before children,
+ * and backwards to visit children before parents.
+ *
+ * Positions, literal values and semantic types are side tables, so sweeps
+ * which only look at the shape of a tree do not pull them into the cache.
+ */
+class flat_tree {
+   std::vector<node_type> node_types;
+   std::vector<symbol_t> node_symbols;
+   std::vector<uint32_t> child_counts;
+
+   /** The number of nodes in the subtree of each node, itself included. */
+   std::vector<uint32_t> subtree_sizes;
+
+   std::vector<uint64_t> start_positions;
+   std::vector<uint64_t> end_positions;
+   std::vector<literal_value> literal_values;
+   std::vector<type_annotation::ptr_t> semantic_types;
+
+   /** The root of each tree, in the order they were added. */
+   std::vector<node_index_t> roots;
+
+public:
+   /** Appends a copy of the tree under root, and returns the index of
+    * its root. */
+   auto
+   add(ast_ptr_t root) -> node_index_t {
+      auto first = node_index_t(node_types.size());
+
+      // Taking children off a stack in reverse order visits them in
+      // pre-order without recursion.
+      ast_list_t stack(1, root);
+      while (!stack.empty()) {
+         auto n = stack.back();
+         stack.pop_back();
+
+         append(n->type, n->symbol, uint32_t(n->children.size()), n->start_pos, n->end_pos, n->literal, nullptr);
+
+         stack.insert(stack.end(), n->children.rbegin(), n->children.rend());
+      }
+
+      end_tree(first);
+      return first;
+   }
+
+   /** Appends one node. Trees are appended in pre-order, a node followed
+    * by the subtree of each of its children in turn, and end_tree() must
+    * be called once the last node of a tree is in. Passes which rewrite
+    * trees build the new ones this way. */
+   auto
+   append(node_type type, symbol_t symbol, uint32_t child_count, uint64_t start, uint64_t end,
+          const literal_value &literal, type_annotation::ptr_t semantic) -> node_index_t {
+      node_types.push_back(type);
+      node_symbols.push_back(symbol);
+      child_counts.push_back(child_count);
+      start_positions.push_back(start);
+      end_positions.push_back(end);
+      literal_values.push_back(literal);
+      semantic_types.push_back(semantic);
+
+      return node_index_t(node_types.size() - 1);
+   }
+
+   /** Finishes the tree whose root is first, which runs to the last node
+    * appended. */
+   void
+   end_tree(node_index_t first) {
+      auto last = node_index_t(node_types.size());
+      subtree_sizes.resize(last);
+
+      // Children come after their parents, so sweeping backwards sizes
+      // every child before its parent needs it.
+      for (auto i = last; i-- > first;) {
+         uint32_t size = 1;
+         for (uint32_t c = 0, child = i + 1; c < child_counts[i]; ++c) {
+            size += subtree_sizes[child];
+            child += subtree_sizes[child];
+         }
+
+         subtree_sizes[i] = size;
+      }
+
+      roots.push_back(first);
+   }
+
+   /** The number of nodes in all trees. */
+   auto
+   size() const -> std::size_t {
+      return node_types.size();
+   }
+
+   /** The roots of the trees, in the order they were added. */
+   auto
+   get_roots() const -> const std::vector<node_index_t> & {
+      return roots;
+   }
+
+   auto
+   type(node_index_t n) const -> node_type {
+      return node_types[n];
+   }
+
+   auto
+   symbol(node_index_t n) const -> symbol_t {
+      return node_symbols[n];
+   }
+
+   auto
+   child_count(node_index_t n) const -> uint32_t {
+      return child_counts[n];
+   }
+
+   /** The first child of n. Only valid when n has children. */
+   auto
+   first_child(node_index_t n) const -> node_index_t {
+      return n + 1;
+   }
+
+   /** The node after the subtree of n, which is its next sibling if it
+    * has one. */
+   auto
+   next_sibling(node_index_t n) const -> node_index_t {
+      return n + subtree_sizes[n];
+   }
+
+   /** Gets child i of n by skipping over the subtrees of the children in
+    * front of it. */
+   auto
+   child(node_index_t n, uint32_t i) const -> node_index_t {
+      auto c = first_child(n);
+      while (i--) {
+         c = next_sibling(c);
+      }
+
+      return c;
+   }
+
+   //=====----------------------------------------------------------------------======//
+   //      Side Tables
+   //=====----------------------------------------------------------------------======//
+
+   auto
+   start_pos(node_index_t n) const -> uint64_t {
+      return start_positions[n];
+   }
+
+   auto
+   end_pos(node_index_t n) const -> uint64_t {
+      return end_positions[n];
+   }
+
+   /** The decoded value of an integer literal. */
+   auto
+   literal(node_index_t n) const -> const literal_value & {
+      return literal_values[n];
+   }
+
+   /** Provides the semantic type of the node. Ie, int, string, etc. */
+   auto
+   semantic_type(node_index_t n) const -> const type_annotation::ptr_t & {
+      return semantic_types[n];
+   }
+
+   void
+   set_semantic_type(node_index_t n, type_annotation::ptr_t t) {
+      semantic_types[n] = t;
+   }
+};
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* FLAT_TREE_H_ */
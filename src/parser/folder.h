@@ -0,0 +1,298 @@
+/*
+ * folder.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef FOLDER_H_
+#define FOLDER_H_
+
+#include <algorithm>
+#include <limits>
+
+#include "module.h"
+
+namespace amalgam {
+namespace parser {
+
+/**
+ * Folds constant subtrees of verified methods into literals, and drops
+ * operations which leave their operand unchanged, such as x*1 and x+0, so
+ * the generator has fewer nodes to turn into instructions.
+ *
+ * An operation is only folded when it has an integer type and its result
+ * fits that type exactly. The generator does its arithmetic in 64 bits,
+ * so anything which would overflow, divide by zero or shift too far is
+ * left for it, and folding never changes what a program computes.
+ *
+ * Groups are kept, even those with a single child. Parentheses do not
+ * make groups, so the only ones left are the blocks of statements, which
+ * the generator needs to see.
+ */
+class folder {
+   /** What folding does to a node. */
+   enum class action : uint8_t {
+      keep,
+      /** The node's whole subtree has a known value. */
+      constant,
+      /** The node is replaced by one of its children. */
+      forward
+   };
+
+   /** The number of nodes the last call to fold() removed. */
+   std::size_t removed;
+
+   static auto
+   fits(const numeric_type_annotation &t, int64_t v) -> bool {
+      if (!t.is_signed) {
+         return v >= 0 && (t.size_in_bits >= 64 || uint64_t(v) < (uint64_t(1) << t.size_in_bits));
+      }
+
+      if (t.size_in_bits >= 64) {
+         return true;
+      }
+
+      auto half = int64_t(1) << (t.size_in_bits - 1);
+      return v >= -half && v < half;
+   }
+
+   /** Works out l op r the way the generator would. Returns false if the
+    * operation is not one the folder knows, or its result would not be
+    * exact in 64 bits. */
+   static auto
+   evaluate(symbol_t op, int64_t l, int64_t r, int64_t &result) -> bool {
+      const auto max = std::numeric_limits<int64_t>::max();
+      const auto min = std::numeric_limits<int64_t>::min();
+
+      switch (op) {
+         case builtin_symbol::add:
+            if ((r > 0 && l > max - r) || (r < 0 && l < min - r)) {
+               return false;
+            }
+            result = l + r;
+            return true;
+
+         case builtin_symbol::sub:
+            if ((r < 0 && l > max + r) || (r > 0 && l < min + r)) {
+               return false;
+            }
+            result = l - r;
+            return true;
+
+         case builtin_symbol::mul:
+            if (l != 0 && r != 0) {
+               auto overflows = (l > 0) ? (r > 0 ? l > max / r : r < min / l) : (r > 0 ? l < min / r : r < max / l);
+               if (overflows) {
+                  return false;
+               }
+            }
+            result = l * r;
+            return true;
+
+         case builtin_symbol::div:
+         case builtin_symbol::rem:
+            if (r == 0 || (l == min && r == -1)) {
+               return false;
+            }
+            result = (op == builtin_symbol::div) ? l / r : l % r;
+            return true;
+
+         case builtin_symbol::bit_and:
+            result = l & r;
+            return true;
+
+         case builtin_symbol::bit_or:
+            result = l | r;
+            return true;
+
+         case builtin_symbol::bit_xor:
+            result = l ^ r;
+            return true;
+
+         case builtin_symbol::shl:
+            if (r < 0 || r >= 64) {
+               return false;
+            }
+            result = int64_t(uint64_t(l) << r);
+            return (result >> r) == l;
+
+         case builtin_symbol::shr:
+            // The generator shifts logically.
+            if (r < 0 || r >= 64) {
+               return false;
+            }
+            result = int64_t(uint64_t(l) >> r);
+            return true;
+      }
+
+      return false;
+   }
+
+   /** Decides whether op leaves its other operand unchanged when one of
+    * them is the constant c. */
+   static auto
+   is_identity(symbol_t op, int64_t c, bool c_is_right) -> bool {
+      switch (op) {
+         case builtin_symbol::add:
+         case builtin_symbol::bit_or:
+         case builtin_symbol::bit_xor:
+            return c == 0;
+
+         case builtin_symbol::mul:
+            return c == 1;
+
+         case builtin_symbol::sub:
+         case builtin_symbol::shl:
+         case builtin_symbol::shr:
+            return c_is_right && c == 0;
+
+         case builtin_symbol::div:
+            return c_is_right && c == 1;
+      }
+
+      return false;
+   }
+
+   void
+   method(module_ptr_t m, method_ptr_t me) {
+      auto &t = me->get_flat_tree();
+      auto size = node_index_t(t.size());
+
+      std::vector<action> actions(size, action::keep);
+      std::vector<int64_t> values(size);
+      std::vector<node_index_t> targets(size);
+      std::vector<uint64_t> starts(size), ends(size);
+
+      // Follows forwarded nodes to the ones which replace them.
+      auto resolve = [&](node_index_t n) {
+         while (actions[n] == action::forward) {
+            n = targets[n];
+         }
+         return n;
+      };
+
+      auto folded = false;
+
+      // Children come after their parents, so a backwards sweep settles
+      // every operand before the operation which uses it.
+      for (auto n = size; n-- > 0;) {
+         starts[n] = t.start_pos(n);
+         ends[n] = t.end_pos(n);
+         for (uint32_t i = 0, c = n + 1; i < t.child_count(n); ++i, c = t.next_sibling(c)) {
+            starts[n] = std::min(starts[n], starts[c]);
+            ends[n] = std::max(ends[n], ends[c]);
+         }
+
+         switch (t.type(n)) {
+            case node_type::literal_int:
+               actions[n] = action::constant;
+               values[n] = t.literal(n).as_signed();
+               break;
+
+            case node_type::op: {
+               if (t.child_count(n) != 2 || t.symbol(n) == builtin_symbol::init) {
+                  break;
+               }
+
+               auto l = resolve(t.first_child(n));
+               auto r = resolve(t.next_sibling(t.first_child(n)));
+               auto lc = actions[l] == action::constant, rc = actions[r] == action::constant;
+
+               auto &type = t.semantic_type(n);
+               int64_t v;
+
+               if (lc && rc && type && type->id == type_annotation::type_id::integer
+                   && evaluate(t.symbol(n), values[l], values[r], v)
+                   && fits(static_cast<const numeric_type_annotation &>(*type), v)) {
+                  actions[n] = action::constant;
+                  values[n] = v;
+                  folded = true;
+               } else if (rc && !lc && is_identity(t.symbol(n), values[r], true)) {
+                  actions[n] = action::forward;
+                  targets[n] = l;
+                  folded = true;
+               } else if (lc && !rc && is_identity(t.symbol(n), values[l], false)) {
+                  actions[n] = action::forward;
+                  targets[n] = r;
+                  folded = true;
+               }
+            }
+               break;
+
+            default:
+               break;
+         }
+      }
+
+      if (!folded) {
+         return;
+      }
+
+      // Copy the trees, leaving out what was folded away.
+      flat_tree out;
+      auto &symbols = *m->get_symbols();
+
+      for (auto root : t.get_roots()) {
+         auto first = node_index_t(out.size());
+
+         std::vector<node_index_t> stack(1, root);
+         while (!stack.empty()) {
+            auto n = resolve(stack.back());
+            stack.pop_back();
+
+            if (actions[n] == action::constant && t.type(n) != node_type::literal_int) {
+               auto &type = static_cast<const numeric_type_annotation &>(*t.semantic_type(n));
+               auto text = std::to_string(values[n]);
+
+               literal_value v;
+               v.bits = uint64_t(values[n]);
+               v.base = 10;
+               v.is_signed = type.is_signed;
+               v.size_in_bits = type.size_in_bits;
+
+               out.append(node_type::literal_int, symbols.intern(text), 0, starts[n], ends[n], v, t.semantic_type(n));
+               continue;
+            }
+
+            out.append(t.type(n), t.symbol(n), t.child_count(n), t.start_pos(n), t.end_pos(n), t.literal(n),
+                       t.semantic_type(n));
+
+            auto at = stack.size();
+            for (uint32_t i = 0, c = n + 1; i < t.child_count(n); ++i, c = t.next_sibling(c)) {
+               stack.insert(stack.begin() + at, c);
+            }
+         }
+
+         out.end_tree(first);
+      }
+
+      removed += t.size() - out.size();
+      t = std::move(out);
+   }
+
+public:
+   folder() :
+            removed(0) {
+   }
+
+   /** Folds the trees of every method of a verified module. */
+   void
+   fold(module_ptr_t m) {
+      removed = 0;
+
+      for (auto &me : m->get_method_map()) {
+         method(m, me.second);
+      }
+   }
+
+   /** Gets the number of nodes the last call to fold() removed. */
+   auto
+   get_removed() const -> std::size_t {
+      return removed;
+   }
+};
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* FOLDER_H_ */
@@ -0,0 +1,254 @@
+/*
+ * inference.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INFERENCE_H_
+#define INFERENCE_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "literals.h"
+#include "type_context.h"
+
+namespace amalgam {
+namespace parser {
+
+/**
+ * Solves the types of an expression from constraints between type
+ * variables. Variables which must have the same type are merged with
+ * union-find, and each set of merged variables carries what is known of
+ * its type: nothing yet, a concrete type, or only that it holds integer
+ * literals.
+ *
+ * Literals do not fix a type on their own. They only need a type which
+ * holds their value, so 10 + 300 is a 16 bit addition rather than a
+ * mismatch, and x + 1 takes the type of x. A set which only ever holds
+ * literals gets the smallest integer type which holds all of them.
+ */
+class type_inference {
+   /** What is known about the type of a set of variables. */
+   struct binding {
+      enum class kind : uint8_t {
+         unknown,
+         literal,
+         concrete
+      };
+
+      kind what;
+
+      /** The type, once it is concrete. */
+      type_annotation::ptr_t type;
+
+      /** For literals: whether any of them is signed or negative, and the
+       * bits the widest of them needs. */
+      bool is_signed;
+      bool negative;
+      uint8_t size_in_bits;
+   };
+
+   std::vector<uint32_t> parents;
+   std::vector<uint8_t> ranks;
+
+   /** The binding of each set, kept at its root. */
+   std::vector<binding> bindings;
+
+   /** Decides whether an integer type holds every literal in b. */
+   static auto
+   holds(const type_annotation &t, const binding &b) -> bool {
+      if (t.id != type_annotation::type_id::integer) {
+         return false;
+      }
+
+      auto &n = static_cast<const numeric_type_annotation &>(t);
+      if (!n.is_signed) {
+         return !b.negative && b.size_in_bits <= n.size_in_bits;
+      }
+
+      // An unsigned literal needs one more bit to be signed.
+      return b.is_signed ? b.size_in_bits <= n.size_in_bits : b.size_in_bits < n.size_in_bits;
+   }
+
+   /** Combines two sets of literals. Returns false if no integer type
+    * holds them all. */
+   static auto
+   merge_literals(binding &a, const binding &b) -> bool {
+      if (a.is_signed == b.is_signed) {
+         a.size_in_bits = std::max(a.size_in_bits, b.size_in_bits);
+      } else {
+         auto &u = a.is_signed ? b : a;
+         auto &s = a.is_signed ? a : b;
+         if (u.size_in_bits >= 64) {
+            return false;
+         }
+
+         a.size_in_bits = std::max<uint8_t>(s.size_in_bits, u.size_in_bits * 2);
+         a.is_signed = true;
+      }
+
+      a.negative = a.negative || b.negative;
+      return true;
+   }
+
+public:
+   /** Forgets every variable, and makes count fresh ones, numbered from
+    * zero, about which nothing is known. */
+   void
+   reset(std::size_t count) {
+      parents.resize(count);
+      ranks.assign(count, 0);
+      bindings.assign(count, binding());
+
+      for (std::size_t v = 0; v < count; ++v) {
+         parents[v] = uint32_t(v);
+         bindings[v].what = binding::kind::unknown;
+      }
+   }
+
+   /** Finds the root of the set v is in. */
+   auto
+   find(uint32_t v) -> uint32_t {
+      while (parents[v] != v) {
+         // Halving the path keeps later finds short.
+         parents[v] = parents[parents[v]];
+         v = parents[v];
+      }
+
+      return v;
+   }
+
+   /** Constrains v to a concrete type. Returns false if it conflicts with
+    * what is already known. A generic type, such as the type of a
+    * parameter declared as 'variable type', stands for any type and does
+    * not constrain v at all. */
+   auto
+   bind(uint32_t v, type_annotation::ptr_t t) -> bool {
+      if (!t || t->id == type_annotation::type_id::generic) {
+         return true;
+      }
+
+      binding b = binding();
+      b.what = binding::kind::concrete;
+      b.type = t;
+
+      return constrain(find(v), b);
+   }
+
+   /** Constrains v to a type which holds a literal. */
+   auto
+   bind_literal(uint32_t v, const literal_value &l) -> bool {
+      binding b = binding();
+      b.what = binding::kind::literal;
+      b.is_signed = l.is_signed;
+      b.negative = l.is_signed && l.as_signed() < 0;
+      b.size_in_bits = l.size_in_bits;
+
+      return constrain(find(v), b);
+   }
+
+   /** Merges the binding b into the set whose root is root. */
+   auto
+   constrain(uint32_t root, const binding &b) -> bool {
+      auto &a = bindings[root];
+
+      if (b.what == binding::kind::unknown) {
+         return true;
+      }
+
+      if (a.what == binding::kind::unknown) {
+         a = b;
+         return true;
+      }
+
+      if (a.what == binding::kind::concrete && b.what == binding::kind::concrete) {
+         // Types are interned, so equal types are the same annotation.
+         return a.type == b.type;
+      }
+
+      if (a.what == binding::kind::literal && b.what == binding::kind::literal) {
+         return merge_literals(a, b);
+      }
+
+      auto &concrete = (a.what == binding::kind::concrete) ? a : b;
+      auto &literals = (a.what == binding::kind::concrete) ? b : a;
+      if (!holds(*concrete.type, literals)) {
+         return false;
+      }
+
+      a = concrete;
+      return true;
+   }
+
+   /** Requires a and b to have the same type. Returns false if they can
+    * not. */
+   auto
+   unify(uint32_t a, uint32_t b) -> bool {
+      a = find(a);
+      b = find(b);
+      if (a == b) {
+         return true;
+      }
+
+      if (ranks[a] < ranks[b]) {
+         std::swap(a, b);
+      }
+
+      // a becomes the root, so it takes on what was known about b. The
+      // sets are left apart if they conflict, so both can be described.
+      if (!constrain(a, bindings[b])) {
+         return false;
+      }
+
+      parents[b] = a;
+      if (ranks[a] == ranks[b]) {
+         ++ranks[a];
+      }
+
+      return true;
+   }
+
+   /** Gets the type v was solved to, or nullptr if nothing constrains it. */
+   auto
+   resolve(uint32_t v, const type_context &types) -> type_annotation::ptr_t {
+      auto &b = bindings[find(v)];
+
+      switch (b.what) {
+         case binding::kind::concrete:
+            return b.type;
+
+         case binding::kind::literal:
+            return types.integer(b.is_signed, b.size_in_bits);
+
+         default:
+            return nullptr;
+      }
+   }
+
+   /** Describes the type of v for error messages. */
+   auto
+   describe(uint32_t v) -> string {
+      auto &b = bindings[find(v)];
+
+      if (b.what == binding::kind::literal) {
+         return "an integer literal";
+      }
+
+      if (b.what != binding::kind::concrete) {
+         return "an unknown type";
+      }
+
+      if (b.type->id == type_annotation::type_id::integer) {
+         auto &n = static_cast<const numeric_type_annotation &>(*b.type);
+         return (n.is_signed ? "int" : "uint") + std::to_string(int(n.size_in_bits));
+      }
+
+      return b.type->name.empty() ? "a composite type" : b.type->name;
+   }
+};
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* INFERENCE_H_ */
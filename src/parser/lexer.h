@@ -0,0 +1,319 @@
+/*
+ * lexer.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef LEXER_H_
+#define LEXER_H_
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "pegtl.hh"
+#include "symbols.h"
+
+namespace amalgam {
+namespace parser {
+
+/** The characters operators are made of:
+ *
+ *    ! # $ % & * + , - . / : ; < = > ? @ [ \ ] ^ { | } ~
+ *
+ * Written as ranges, so that a run of them can be scanned in a few vector
+ * compares. */
+typedef pegtl::char_class<pegtl::class_set<'!'>, pegtl::class_range<'#', '&'>, pegtl::class_range<'*', '/'>,
+      pegtl::class_range<':', '@'>, pegtl::class_range<'[', '^'>, pegtl::class_range<'{', '~'> > op_class;
+
+enum class token_kind : uint8_t {
+   /** Digits, followed by any letters which specify the type. The sign
+    * of a signed literal is a separate op token right in front of it. */
+   integer,
+   identifier,
+   /** A run of operator characters. */
+   op,
+   open,
+   close,
+   eol,
+   /** A character which can not start any token. */
+   invalid
+};
+
+/**
+ * The tokens of a piece of source text. Each property is kept in an array
+ * of its own rather than in an array of structures, since the parser
+ * mostly looks at kinds and symbols, and rarely at positions.
+ */
+struct token_array {
+   std::vector<token_kind> kinds;
+
+   /** Where each token starts in the source. */
+   std::vector<uint64_t> offsets;
+
+   std::vector<uint32_t> lengths;
+
+   /** The interned text of each token, or no_symbol for end of line and
+    * invalid tokens. */
+   std::vector<symbol_t> symbols;
+
+   /** Where the source text ends, which is where end of input is. */
+   uint64_t end;
+
+   token_array() :
+            end(0) {
+   }
+
+   auto
+   size() const -> std::size_t {
+      return kinds.size();
+   }
+
+   void
+   push_back(token_kind kind, uint64_t offset, uint32_t length, symbol_t symbol) {
+      kinds.push_back(kind);
+      offsets.push_back(offset);
+      lengths.push_back(length);
+      symbols.push_back(symbol);
+   }
+};
+
+namespace lexer_grammar {
+using namespace pegtl;
+
+/** What the token rules add to, and where the text they run over starts. */
+struct state {
+   token_array &tokens;
+   symbol_table &symbols;
+   const char *text;
+   uint64_t base;
+};
+
+/** Adds the matched text as a token of a kind, interning its text. */
+template<token_kind Kind>
+   struct add_token : action_base<add_token<Kind> > {
+      static void
+      apply(const match_view &v, state &s) {
+         auto sym = (Kind == token_kind::eol || Kind == token_kind::invalid) ? no_symbol : s.symbols.intern(s.text + v.offset, v.length);
+         s.tokens.push_back(Kind, s.base + v.offset, uint32_t(v.length), sym);
+      }
+   };
+
+template<token_kind Kind, typename Rule>
+   struct token_rule : ifapply_view<Rule, add_token<Kind> > {
+   };
+
+struct blanks : plus_run<blank_class> {
+};
+
+// Hexadecimal literals may have letters among their digits.
+struct integer : token_rule<token_kind::integer, seq<plus_run<digit_class>, star_run<alnum_class> > > {
+};
+
+struct identifier : token_rule<token_kind::identifier, seq<plus_run<ident1_class>, star_run<ident2_class> > > {
+};
+
+struct op : token_rule<token_kind::op, plus_run<op_class> > {
+};
+
+struct open : token_rule<token_kind::open, one<'('> > {
+};
+
+struct close : token_rule<token_kind::close, one<')'> > {
+};
+
+struct eol : token_rule<token_kind::eol, sor<pegtl::string<'\r', '\n'>, one<'\n'>, one<'\r'> > > {
+};
+
+struct invalid : token_rule<token_kind::invalid, any> {
+};
+
+struct token : sor<blanks, integer, identifier, op, open, close, eol, invalid> {
+};
+
+struct grammar : until<eof, token> {
+};
+
+/** Keeps the text matched by stream_line. */
+struct keep_line : action_base<keep_line> {
+   static void
+   apply(const std::string &s, std::string &line) {
+      line = s;
+   }
+};
+
+/** Matches one line of a stream, with its line break if it has one. */
+struct stream_line : ifapply<seq<star<not_one<'\r', '\n'> >, sor<crlf, lf, cr, eof> >, keep_line> {
+};
+
+} // end lexer_grammar namespace
+
+/**
+ * Splits text into tokens, interning the text of every literal, identifier
+ * and operator once. Blanks are dropped. Offsets count from base, so that
+ * text which is only part of a source, such as one line of a stream, can
+ * be lexed on its own.
+ */
+inline auto
+lex(const char *begin, const char *end, symbol_table &symbols, uint64_t base = 0) -> token_array {
+   token_array tokens;
+
+   // Most tokens are short, so this is rarely far off.
+   tokens.kinds.reserve((end - begin) / 3);
+   tokens.offsets.reserve((end - begin) / 3);
+   tokens.lengths.reserve((end - begin) / 3);
+   tokens.symbols.reserve((end - begin) / 3);
+
+   lexer_grammar::state s = { tokens, symbols, begin, base };
+   pegtl::forward_input<const char*, pegtl::dummy_location> in(begin, end);
+   pegtl::dummy_parse<lexer_grammar::grammar>(in, s);
+
+   tokens.end = base + (end - begin);
+   return tokens;
+}
+
+/** Where a token_input is: the index of the next token, and where that
+ * token starts in the source. */
+struct token_location {
+   std::size_t index;
+   uint64_t offset;
+};
+
+inline std::ostream &
+operator<<(std::ostream &o, const token_location &l) {
+   return o << "token " << l.index << " (offset " << l.offset << ")";
+}
+
+/**
+ * A PEGTL input over a token array. Rules made of the PEGTL combinators
+ * run over it unchanged, except that bump() moves over a whole token, so
+ * backtracking replays tokens instead of scanning characters again.
+ * offset() gives positions in the source text, so that match_view and
+ * the debug classes report the same positions they would for characters.
+ */
+class token_input : private pegtl::nocopy<token_input> {
+   const token_array &tokens;
+   std::size_t run;
+
+public:
+   token_input(const token_array &_tokens) :
+            tokens(_tokens), run(0) {
+   }
+
+   typedef token_location location_type;
+   typedef std::size_t iterator;
+
+   template<bool Must>
+      struct marker : public pegtl::forward_marker<Must, token_input> {
+         explicit
+         marker(token_input &input) :
+                  pegtl::forward_marker<Must, token_input>(input) {
+         }
+      };
+
+   auto
+   eof() const -> bool {
+      return run == tokens.size();
+   }
+
+   auto
+   here() const -> const iterator & {
+      return run;
+   }
+
+   auto
+   rewind() -> token_input & {
+      run = 0;
+      return *this;
+   }
+
+   auto
+   location() const -> location_type {
+      token_location l = { run, offset(run) };
+      return l;
+   }
+
+   void
+   bump() {
+      if (eof()) {
+         PEGTL_THROW("attempt to read beyond end of input");
+      }
+      ++run;
+   }
+
+   void
+   jump(const iterator i) {
+      run = i;
+   }
+
+   auto
+   offset(const iterator i) const -> std::size_t {
+      return i < tokens.size() ? tokens.offsets[i] : tokens.end;
+   }
+
+   auto
+   debug_escape(const iterator begin, const iterator end) const -> std::string {
+      std::string s;
+      for (auto i = begin; i != end; ++i) {
+         s += (i == begin) ? "" : " ";
+         s += "#" + std::to_string(tokens.symbols[i]);
+      }
+      return s;
+   }
+
+   /** The kind of the next token. Only valid when not at eof(). */
+   auto
+   kind() const -> token_kind {
+      return tokens.kinds[run];
+   }
+
+   /** The symbol of the next token. Only valid when not at eof(). */
+   auto
+   symbol() const -> symbol_t {
+      return tokens.symbols[run];
+   }
+
+   /** Where the next token starts. Only valid when not at eof(). */
+   auto
+   start() const -> uint64_t {
+      return tokens.offsets[run];
+   }
+
+   /** The length of the next token. Only valid when not at eof(). */
+   auto
+   length() const -> std::size_t {
+      return tokens.lengths[run];
+   }
+};
+
+/** A rule which matches one token of a kind. */
+template<token_kind Kind>
+   struct token {
+      typedef token key_type;
+
+      template<typename Print>
+         static void
+         prepare(Print &st) {
+            st.template update<token>("token<" + std::to_string(int(Kind)) + ">", true);
+         }
+
+      template<bool Must, typename Input, typename Debug, typename ... States>
+         static bool
+         match(Input &in, Debug &, States && ...) {
+            if (in.eof() || in.kind() != Kind) {
+               return false;
+            }
+
+            in.bump();
+            return true;
+         }
+   };
+
+/** Matches the end of a line, or the end of the input. */
+struct end_of_line : pegtl::sor<pegtl::eof, token<token_kind::eol> > {
+};
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* LEXER_H_ */
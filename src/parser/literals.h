@@ -0,0 +1,162 @@
+/*
+ * literals.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef LITERALS_H_
+#define LITERALS_H_
+
+#include <cstdint>
+#include <limits>
+
+#include "types.h"
+
+namespace amalgam {
+namespace parser {
+
+/** The value of an integer literal, decoded once when it is parsed so
+ * that later passes never have to read its text again. */
+struct literal_value {
+   /** The value. Signed values are stored in two's complement. */
+   uint64_t bits;
+
+   /** The base the digits were written in. */
+   uint8_t base;
+
+   bool is_signed;
+
+   /** The smallest of 8, 16, 32 and 64 bits which holds the value. */
+   uint8_t size_in_bits;
+
+   /** Gets the value of a signed literal. */
+   auto
+   as_signed() const -> int64_t {
+      return int64_t(bits);
+   }
+};
+
+/**
+ * Decodes the text of an integer literal: an optional sign, digits, and a
+ * specifier at the end which picks the base and signedness:
+ *
+ *    (none) decimal   h hexadecimal   b binary   o octal
+ *
+ * with a U in front of the specifier making the literal unsigned, as in
+ * 10Uh. Hexadecimal digits may be in either case, but a literal must
+ * start with a decimal digit, as in 0ffh, so that it is not taken for an
+ * identifier.
+ *
+ * Returns nullptr if the literal is valid, or else what is wrong with it.
+ */
+inline auto
+decode_int_literal(const char *text, std::size_t length, literal_value &v) -> const char * {
+   auto run = text, end = text + length;
+
+   v.base = 10;
+   v.is_signed = true;
+
+   auto negative = false;
+   if (run != end && (*run == '+' || *run == '-')) {
+      negative = *run == '-';
+      ++run;
+   }
+
+   // The specifier is split off the end first, since b is also a
+   // hexadecimal digit.
+   auto digits_end = end;
+   if (digits_end != run && !(*(digits_end - 1) >= '0' && *(digits_end - 1) <= '9')) {
+      switch (*--digits_end) {
+         case 'h':
+            v.base = 16;
+            break;
+         case 'b':
+            v.base = 2;
+            break;
+         case 'o':
+            v.base = 8;
+            break;
+         default:
+            return "has an unknown specifier";
+      }
+
+      if (digits_end != run && *(digits_end - 1) == 'U') {
+         --digits_end;
+         v.is_signed = false;
+      }
+   }
+
+   if (run == digits_end) {
+      return "has no digits";
+   }
+
+   if (!(*run >= '0' && *run <= '9')) {
+      return "does not start with a decimal digit";
+   }
+
+   uint64_t magnitude = 0;
+   for (; run != digits_end; ++run) {
+      unsigned digit;
+      if (*run >= '0' && *run <= '9') {
+         digit = *run - '0';
+      } else if (*run >= 'a' && *run <= 'f') {
+         digit = *run - 'a' + 10;
+      } else if (*run >= 'A' && *run <= 'F') {
+         digit = *run - 'A' + 10;
+      } else {
+         digit = v.base;
+      }
+
+      if (digit >= v.base) {
+         return "has a digit which is not valid in its base";
+      }
+
+      if (magnitude > (std::numeric_limits<uint64_t>::max() - digit) / v.base) {
+         return "is too large";
+      }
+
+      magnitude = magnitude * v.base + digit;
+   }
+
+   if (!v.is_signed) {
+      if (negative && magnitude != 0) {
+         return "is unsigned, but negative";
+      }
+
+      v.bits = magnitude;
+      v.size_in_bits = 64;
+      for (uint8_t size = 8; size < 64; size *= 2) {
+         if (magnitude < (uint64_t(1) << size)) {
+            v.size_in_bits = size;
+            break;
+         }
+      }
+
+      return nullptr;
+   }
+
+   // A negative value can be one further from zero than a positive one.
+   auto limit = uint64_t(std::numeric_limits<int64_t>::max()) + (negative ? 1 : 0);
+   if (magnitude > limit) {
+      return "is too large";
+   }
+
+   v.bits = negative ? (~magnitude + 1) : magnitude;
+   v.size_in_bits = 64;
+
+   auto value = v.as_signed();
+   for (uint8_t size = 8; size < 64; size *= 2) {
+      auto half = int64_t(1) << (size - 1);
+      if (value >= -half && value < half) {
+         v.size_in_bits = size;
+         break;
+      }
+   }
+
+   return nullptr;
+}
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* LITERALS_H_ */
@@ -8,10 +8,9 @@
 #ifndef METHOD_H_
 #define METHOD_H_
 
-#include <map>
-
 #include "annotations.h"
-#include "ast.h"
+#include "flat_tree.h"
+#include "symbol_map.h"
 
 namespace amalgam {
 namespace parser {
@@ -23,25 +22,35 @@ typedef std::shared_ptr<method> method_ptr_t;
 /** The type for lists of methods. */
 typedef std::vector<method_ptr_t> method_list_t;
 
-/** The type for maps of methods. */
-typedef std::map<std::string, method_ptr_t> method_map_t;
+/** The type for maps of methods, by interned name. */
+typedef symbol_map<method_ptr_t> method_map_t;
+
+/** The type for maps of variables, by interned name. */
+typedef symbol_map<type_annotation::ptr_t> variable_map_t;
 
 class method {
    /** The name of the method. */
    string name;
 
-   /** The list of expressions to evaluate in this method. */
-   ast_list_t expression_list;
+   /** The expressions to evaluate in this method. */
+   flat_tree tree;
 
    /** The type of the method. */
    method_type_annotation type;
 
    /** The list of variables declared in this method. */
-   type_annotation::map_t vars;
+   variable_map_t vars;
+
+   /** The method this one is nested in, whose variables it can see, or
+    * nullptr for the outermost one. */
+   method *enclosing;
+
+   /** The symbol table of the module which owns this method. */
+   symbol_table_ptr_t symbols;
 
 public:
-   method(const std::string _name) :
-         name(_name) {
+   method(const std::string _name, symbol_table_ptr_t _symbols) :
+         name(_name), enclosing(nullptr), symbols(_symbols) {
    }
 
    /** Gets the name of the method */
@@ -50,21 +59,31 @@ public:
       return name;
    }
 
+   /** Gets the type of the method: its inputs and outputs. */
+   auto
+   get_type() -> method_type_annotation & {
+      return type;
+   }
+
    //=====----------------------------------------------------------------------======//
    //      Expression Trees
    //=====----------------------------------------------------------------------======//
 
 
    /** Adds a completely parsed expression tree to the list
-    * of expressions this method must process. */
+    * of expressions this method must process. The tree is flattened,
+    * and only the flat copy is kept. */
    void
    add_expression_tree(ast_ptr_t node) {
-      expression_list.push_back(node);
+      tree.add(node);
    }
 
-   /** Gets the expression tree list for iteration purposes. */
-   auto get_expression_tree_list() -> const ast_list_t & {
-      return expression_list;
+   /** Gets the expression trees. Every pass after the parser reads them
+    * from here, and passes which rewrite them, like the folder, replace
+    * them here. */
+   auto
+   get_flat_tree() -> flat_tree & {
+      return tree;
    }
 
    //=====----------------------------------------------------------------------======//
@@ -74,38 +93,88 @@ public:
 
    /** Adds a variable to this method. This is generally called by
     * the verifier during processing of the expression list.*/
-   void add_variable(string name, type_annotation::ptr_t t) {
-      vars[name] = t;
+   void add_variable(symbol_t name, type_annotation::ptr_t t) {
+      vars.set(name, t);
    }
 
    /** Looks for a variable declared in this method with the given name. */
-   bool has_variable(string name) {
-      return vars.find(name) != vars.end();
+   bool has_variable(symbol_t name) {
+      return vars.contains(name);
    }
 
-   //=====----------------------------------------------------------------------======//
-   //      Parser Debugging and Instrumentation
-   //=====----------------------------------------------------------------------======//
+   /** Looks for a variable declared in this method with the given name. */
+   bool has_variable(const string &name) {
+      auto sym = symbols->lookup(name);
+      return sym != no_symbol && has_variable(sym);
+   }
+
+   /** Gets the type of a variable declared in this method, or nullptr if
+    * there is no such variable. */
+   auto
+   get_variable(symbol_t name) -> type_annotation::ptr_t {
+      auto t = vars.find(name);
+      return t ? *t : nullptr;
+   }
 
+   /** Used to be able to iterate over the variables. */
+   auto
+   get_variables() -> const variable_map_t & {
+      return vars;
+   }
+
+   /** Sets the method this one is nested in. */
    void
-   dump() {
-      for (auto n : expression_list) {
-         std::cout << std::endl
-                   << (int) (n->type) << ":'" << n->data << "'" << std::endl;
+   set_enclosing(method *m) {
+      enclosing = m;
+   }
+
+   /** Gets the method this one is nested in, or nullptr. */
+   auto
+   get_enclosing() -> method * {
+      return enclosing;
+   }
 
-         print_children(n, 1);
+   /** Looks for a variable visible in this method: one declared in it, or
+    * else in the methods it is nested in, the innermost first. Returns
+    * nullptr if there is no such variable. */
+   auto
+   find_variable(symbol_t name) -> type_annotation::ptr_t {
+      for (auto m = this; m; m = m->enclosing) {
+         auto t = m->vars.find(name);
+         if (t) {
+            return *t;
+         }
       }
+
+      return nullptr;
    }
 
-private:
-   void
-   print_children(ast_ptr_t n, int indent) {
-      auto indent_str = std::string(indent, ' ');
-      for (auto c : n->children) {
-         std::cout << indent_str << "|" << (int) (c->type) << ": '" << c->data
-               << "'" << std::endl;
+   //=====----------------------------------------------------------------------======//
+   //      Parser Debugging and Instrumentation
+   //=====----------------------------------------------------------------------======//
 
-         print_children(c, indent + 1);
+   void
+   dump() {
+      // The number of children still to be printed for each node on the
+      // path from the root, which is also how far to indent.
+      std::vector<uint32_t> pending;
+
+      for (node_index_t n = 0; n < tree.size(); ++n) {
+         while (!pending.empty() && pending.back() == 0) {
+            pending.pop_back();
+         }
+
+         if (pending.empty()) {
+            std::cout << std::endl
+                      << (int) (tree.type(n)) << ":'" << symbols->name(tree.symbol(n)) << "'" << std::endl;
+         } else {
+            --pending.back();
+
+            std::cout << std::string(pending.size(), ' ') << "|" << (int) (tree.type(n)) << ": '"
+                  << symbols->name(tree.symbol(n)) << "'" << std::endl;
+         }
+
+         pending.push_back(tree.child_count(n));
       }
    }
 
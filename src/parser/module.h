@@ -8,7 +8,10 @@
 #ifndef MODULE_H_
 #define MODULE_H_
 
+#include "diagnostics.h"
 #include "method.h"
+#include "source.h"
+#include "type_context.h"
 
 namespace amalgam {
 namespace parser {
@@ -20,6 +23,22 @@ typedef std::shared_ptr<module> module_ptr_t;
 /** The type for lists of methods. */
 typedef std::vector<module_ptr_t> module_list_t;
 
+/** An import statement: from module import name, name... */
+struct module_import {
+   /** The module to import from, with dots between the parts of its
+    * path, as written. */
+   string module;
+
+   /** The names to import. */
+   std::vector<string> names;
+
+   /** Where the statement is in the input stream. */
+   uint64_t offset;
+};
+
+/** The type for lists of imports. */
+typedef std::vector<module_import> import_list_t;
+
 class module {
    /** The name of the module. */
    string name;
@@ -27,7 +46,7 @@ class module {
    /** The path to the module. */
    string path;
 
-   /** The list of methods internal to this module. */
+   /** The list of methods internal to this module, by interned name. */
    method_map_t methods;
 
    /** Methods may be nested. In fact, they are always nested
@@ -39,13 +58,42 @@ class module {
     * effort at any time. There is always a current method. */
    method_ptr_t current_method;
 
-   /** The map of type names to type annotations. */
-   type_annotation::map_t types;
+   /** The map of interned type names to type annotations. */
+   symbol_map<type_annotation::ptr_t> types;
+
+   /** Hands out the canonical annotation of each type used in this module. */
+   type_context_ptr_t type_ctx;
+
+   /** Owns every AST node parsed into this module. */
+   ast_arena_t nodes;
+
+   /** Interns every identifier, literal and operator in this module. */
+   symbol_table_ptr_t symbols;
+
+   /** The text this module was parsed from. */
+   source_ptr_t src;
+
+   /** Problems found while parsing. */
+   diagnostic_list_t diagnostics;
+
+   /** The import statements, in the order they appear. */
+   import_list_t imports;
+
+   /** The signatures of the methods imported from other modules, by
+    * name. A name may have several, one per overload. */
+   symbol_map<type_annotation::list_t> imported_methods;
 
 public:
-   module(const string &_name) :
-         name(_name) {
-      add_method(method_ptr_t(new method("__default__")));
+   /** Creates a module. The symbol table may already hold symbols, such
+    * as those used by syntax forms; a fresh one is made if it is null.
+    * The type context may be shared with earlier parses of the same
+    * module, so that their types stay canonical; a fresh one is made if
+    * it is null. */
+   module(const string &_name, const string &_path = string(),
+          symbol_table_ptr_t _symbols = symbol_table_ptr_t(), type_context_ptr_t _types = type_context_ptr_t()) :
+         name(_name), path(_path), type_ctx(_types ? _types : type_context_ptr_t(new type_context())),
+         symbols(_symbols ? _symbols : symbol_table_ptr_t(new symbol_table())) {
+      add_method(method_ptr_t(new method("__default__", symbols)));
       push_current_method("__default__");
    }
 
@@ -55,6 +103,61 @@ public:
       return name;
    }
 
+   /** Gets the path the module was loaded from. This is empty for
+    * modules which were not loaded from a file. */
+   auto
+   get_path() -> const std::string & {
+      return path;
+   }
+
+   //=====----------------------------------------------------------------------======//
+   //      AST Nodes
+   //=====----------------------------------------------------------------------======//
+
+   /** Allocates a new AST node in this module's arena. The node lives
+    * exactly as long as the module does. */
+   auto
+   make_ast() -> ast_ptr_t {
+      return nodes.make();
+   }
+
+   /** Gets the table which interns this module's token text. */
+   auto
+   get_symbols() -> symbol_table_ptr_t {
+      return symbols;
+   }
+
+   /** Sets the text this module is parsed from. */
+   void
+   set_source(source_ptr_t s) {
+      src = s;
+   }
+
+   /** Gets the text this module was parsed from. */
+   auto
+   get_source() -> source_ptr_t {
+      return src;
+   }
+
+   /** Gets a copy of the source text a node was parsed from. */
+   auto
+   get_source_text(ast_ptr_t n) -> string {
+      return src->text(n->start_pos, n->end_pos);
+   }
+
+   /** Gets a copy of the source text node n of a flat tree was parsed
+    * from. */
+   auto
+   get_source_text(const flat_tree &t, node_index_t n) -> string {
+      return src->text(t.start_pos(n), t.end_pos(n));
+   }
+
+   /** The number of AST nodes allocated in this module. */
+   auto
+   get_ast_count() -> std::size_t {
+      return nodes.size();
+   }
+
    //=====----------------------------------------------------------------------======//
    //      Methods
    //=====----------------------------------------------------------------------======//
@@ -63,12 +166,19 @@ public:
    /** This should be used when entering a new method in the
     * parse stream. Pushes the old current method onto the
     * nested method stack, and then sets the current method
-    * to the method with the given name.
+    * to the method with the given name, which must have been
+    * added. The method is nested in the old current method,
+    * so it can see that method's variables.
     */
    void
    push_current_method(const std::string &name) {
+      auto m = get_method(name);
+      if (current_method && m != current_method) {
+         m->set_enclosing(current_method.get());
+      }
+
       nested_method_stack.push_back(current_method);
-      current_method = methods[name];
+      current_method = m;
    }
 
    /** This should be used when exiting a method in the
@@ -90,23 +200,31 @@ public:
       return current_method;
    }
 
-   /** Adds a method to the module. */
+   /** Adds a method to the module. Until it is entered with
+    * push_current_method(), it is taken to be nested in
+    * '__default__'. */
    void
    add_method(method_ptr_t m) {
-      methods[m->get_name()] = m;
+      auto outer = methods.empty() ? nullptr : get_method("__default__");
+      if (outer && outer != m) {
+         m->set_enclosing(outer.get());
+      }
+
+      methods.set(symbols->intern(m->get_name()), m);
    }
 
    /** Indicates if the module has the named method. */
    auto
    has_method(const string &name) -> bool {
-      return methods.find(name) != methods.end();
+      return methods.contains(symbols->lookup(name));
    }
 
-   /** Gets a handle to the named method. If the method does not
-    * exist, this code will fail. */
+   /** Gets a handle to the named method, or nullptr if there is no
+    * such method. */
    auto
    get_method(const string &name) -> method_ptr_t {
-      return methods[name];
+      auto m = methods.find(symbols->lookup(name));
+      return m ? *m : nullptr;
    }
 
    /** Used to be able to iterate over the collection of methods. */
@@ -127,18 +245,96 @@ public:
    /** Adds a type annotation to the module. */
    void
    add_type(type_annotation::ptr_t m) {
-      types[m->name] = m;
+      types.set(symbols->intern(m->name), m);
    }
 
    /** Indicates if the module has the named type. */
    auto
    has_type(const string &name) -> bool {
-      return types.find(name) != types.end();
+      return types.contains(symbols->lookup(name));
    }
 
+   /** Gets the named type, or nullptr if there is no such type. Looking
+    * up a missing type does not add it, so lookups can run on several
+    * threads at once. */
    auto
    get_type(const string &name) ->  type_annotation::ptr_t {
-      return types[name];
+      auto t = types.find(symbols->lookup(name));
+      return t ? *t : nullptr;
+   }
+
+   /** Gets the context which interns this module's type annotations. */
+   auto
+   get_type_context() -> type_context & {
+      return *type_ctx;
+   }
+
+   /** Used to be able to iterate over the types. */
+   auto
+   get_type_map() -> const symbol_map<type_annotation::ptr_t> & {
+      return types;
+   }
+
+   //=====----------------------------------------------------------------------======//
+   //      Imports
+   //=====----------------------------------------------------------------------======//
+
+   /** Records an import statement. The parser resolves imports before
+    * the module is verified. */
+   void
+   add_import(const module_import &i) {
+      imports.push_back(i);
+   }
+
+   /** Gets the import statements, in the order they appear. */
+   auto
+   get_imports() -> const import_list_t & {
+      return imports;
+   }
+
+   /** Adds the signature of one overload of a method imported from
+    * another module. */
+   void
+   add_imported_method(const string &name, type_annotation::ptr_t signature) {
+      auto sym = symbols->intern(name);
+      auto overloads = imported_methods.find(sym);
+      if (!overloads) {
+         overloads = &imported_methods.set(sym, type_annotation::list_t());
+      }
+
+      overloads->push_back(signature);
+   }
+
+   /** Gets the signatures of every overload of an imported method, or
+    * nullptr if no method of that name was imported. */
+   auto
+   find_imported_method(const string &name) -> const type_annotation::list_t * {
+      return imported_methods.find(symbols->lookup(name));
+   }
+
+   //=====----------------------------------------------------------------------======//
+   //      Diagnostics
+   //=====----------------------------------------------------------------------======//
+
+   /** Records a problem found at offset. The line and column are filled
+    * in later, once the parser knows them. */
+   void
+   add_diagnostic(uint64_t offset, const string &message) {
+      diagnostic d = { offset, 0, 0, message };
+      diagnostics.push_back(d);
+   }
+
+   /** Gets the problems found while parsing, in the order they appear in
+    * the source. */
+   auto
+   get_diagnostics() -> diagnostic_list_t & {
+      return diagnostics;
+   }
+
+   /** Indicates if any problems were found while parsing. */
+   auto
+   has_diagnostics() -> bool {
+      return !diagnostics.empty();
    }
 
    //=====----------------------------------------------------------------------======//
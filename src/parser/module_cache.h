@@ -0,0 +1,270 @@
+/*
+ * module_cache.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef MODULE_CACHE_H_
+#define MODULE_CACHE_H_
+
+#include "binary_io.h"
+#include "module.h"
+
+namespace amalgam {
+namespace parser {
+
+/**
+ * Saves parsed modules to disk and loads them back, so that a file which
+ * has not changed since it was last parsed does not have to be parsed
+ * again. A cache file is keyed by a hash of the source it was parsed
+ * from, and is ignored when the hash does not match.
+ *
+ * The expression trees are written in the layout of flat_tree: one array
+ * per node property, in pre-order. Loading maps the file into memory and
+ * copies the arrays straight out of it. The import statements are saved
+ * as well, since they are recorded while parsing and not in the trees.
+ */
+class module_cache {
+public:
+   /** Bumped whenever the layout changes. */
+   static const uint32_t cache_version = 4;
+
+private:
+   /** Reads the trees of one method, and adds them to it. Symbols are
+    * translated with remap, since the module's symbol table need not
+    * number them the way the saved one did. */
+   static auto
+   read_trees(binary_reader &r, const std::vector<symbol_t> &remap, method_ptr_t me) -> bool {
+      uint32_t count;
+      if (!r.read(count)) {
+         return false;
+      }
+
+      // The count comes from the file, so it is checked against what is
+      // left of it before anything is allocated.
+      const std::size_t bytes_per_node = sizeof(uint8_t) + sizeof(symbol_t) + sizeof(uint32_t)
+                                         + 3 * sizeof(uint64_t) + 3 * sizeof(uint8_t);
+      if (uint64_t(count) * bytes_per_node > uint64_t(r.end - r.run)) {
+         return false;
+      }
+
+      std::vector<uint8_t> types(count);
+      std::vector<symbol_t> symbols(count);
+      std::vector<uint32_t> child_counts(count);
+      std::vector<uint64_t> starts(count), ends(count);
+      std::vector<uint64_t> bits(count);
+      std::vector<uint8_t> bases(count), signs(count), sizes(count);
+
+      if (!r.read_array(types.data(), count) || !r.read_array(symbols.data(), count)
+          || !r.read_array(child_counts.data(), count) || !r.read_array(starts.data(), count)
+          || !r.read_array(ends.data(), count) || !r.read_array(bits.data(), count)
+          || !r.read_array(bases.data(), count) || !r.read_array(signs.data(), count)
+          || !r.read_array(sizes.data(), count)) {
+         return false;
+      }
+
+      auto &t = me->get_flat_tree();
+      auto first = node_index_t(t.size());
+
+      // How many children the nodes on the path from the root still need.
+      std::vector<uint32_t> open;
+
+      for (uint32_t i = 0; i < count; ++i) {
+         if (types[i] > uint8_t(node_type::statement) || symbols[i] >= remap.size()) {
+            return false;
+         }
+
+         if (open.empty()) {
+            first = node_index_t(t.size());
+         }
+
+         literal_value v;
+         v.bits = bits[i];
+         v.base = bases[i];
+         v.is_signed = signs[i] != 0;
+         v.size_in_bits = sizes[i];
+
+         t.append(node_type(types[i]), remap[symbols[i]], child_counts[i], starts[i], ends[i], v, nullptr);
+
+         if (!open.empty()) {
+            --open.back();
+         }
+
+         open.push_back(child_counts[i]);
+
+         // Finished trees are ended as soon as they are complete.
+         while (!open.empty() && open.back() == 0) {
+            open.pop_back();
+
+            if (open.empty()) {
+               t.end_tree(first);
+            }
+         }
+      }
+
+      return open.empty();
+   }
+
+   /** Writes the trees of every method of m to out. */
+   static void
+   write(std::ostream &out, module_ptr_t m, uint64_t hash) {
+      write_binary_header(out, "AMAC", cache_version, hash);
+
+      auto &symbols = *m->get_symbols();
+      write_binary(out, uint32_t(symbols.size() - builtin_symbol::count));
+      for (auto sym = symbol_t(builtin_symbol::count); sym < symbols.size(); ++sym) {
+         write_binary_string(out, symbols.name(sym));
+      }
+
+      write_binary(out, uint32_t(m->get_method_map().size()));
+      for (auto &it : m->get_method_map()) {
+         auto &t = it.second->get_flat_tree();
+         auto count = node_index_t(t.size());
+
+         write_binary_string(out, it.second->get_name());
+         write_binary(out, count);
+
+         for (node_index_t n = 0; n < count; ++n) {
+            write_binary(out, uint8_t(t.type(n)));
+         }
+         for (node_index_t n = 0; n < count; ++n) {
+            write_binary(out, t.symbol(n));
+         }
+         for (node_index_t n = 0; n < count; ++n) {
+            write_binary(out, t.child_count(n));
+         }
+         for (node_index_t n = 0; n < count; ++n) {
+            write_binary(out, t.start_pos(n));
+         }
+         for (node_index_t n = 0; n < count; ++n) {
+            write_binary(out, t.end_pos(n));
+         }
+
+         // The literals are written a field at a time, so that no padding
+         // ends up in the file.
+         for (node_index_t n = 0; n < count; ++n) {
+            write_binary(out, t.literal(n).bits);
+         }
+         for (node_index_t n = 0; n < count; ++n) {
+            write_binary(out, t.literal(n).base);
+         }
+         for (node_index_t n = 0; n < count; ++n) {
+            write_binary(out, uint8_t(t.literal(n).is_signed));
+         }
+         for (node_index_t n = 0; n < count; ++n) {
+            write_binary(out, t.literal(n).size_in_bits);
+         }
+      }
+
+      write_binary(out, uint32_t(m->get_imports().size()));
+      for (auto &i : m->get_imports()) {
+         write_binary_string(out, i.module);
+         write_binary(out, i.offset);
+
+         write_binary(out, uint32_t(i.names.size()));
+         for (auto &name : i.names) {
+            write_binary_string(out, name);
+         }
+      }
+   }
+
+public:
+   /** Hashes the source of a module, together with the fingerprint of the
+    * syntax it is parsed with, since that changes how it parses too. */
+   static auto
+   hash(const char *data, std::size_t size, uint64_t syntax_fingerprint) -> uint64_t {
+      return hash_bytes(data, size, syntax_fingerprint);
+   }
+
+   /** Writes the trees of every method of m to path. Returns false if the
+    * file could not be written; see save_binary_file(). */
+   static auto
+   save(module_ptr_t m, const string &path, uint64_t hash) -> bool {
+      return save_binary_file(path, [&](std::ostream &out) {
+         write(out, m, hash);
+      });
+   }
+
+   /** Reads the trees written by save() into m, which must be freshly
+    * made. Returns false, leaving m unusable, if there is no cache at
+    * path, or it was saved from a different source. */
+   static auto
+   load(module_ptr_t m, const string &path, uint64_t hash) -> bool {
+      std::unique_ptr<pegtl::file_mapper> file;
+
+      try {
+         file.reset(new pegtl::file_mapper(path));
+      } catch (const pegtl::parse_error &) {
+         return false;
+      }
+
+      binary_reader r = { file->data(), file->data() + file->size() };
+
+      uint32_t count;
+      if (!r.read_header("AMAC", cache_version, hash) || !r.read(count)) {
+         return false;
+      }
+
+      std::vector<symbol_t> remap;
+      for (symbol_t sym = 0; sym < builtin_symbol::count; ++sym) {
+         remap.push_back(sym);
+      }
+
+      string name;
+      for (uint32_t i = 0; i < count; ++i) {
+         if (!r.read_string(name)) {
+            return false;
+         }
+
+         remap.push_back(m->get_symbols()->intern(name));
+      }
+
+      if (!r.read(count)) {
+         return false;
+      }
+
+      for (uint32_t i = 0; i < count; ++i) {
+         if (!r.read_string(name)) {
+            return false;
+         }
+
+         if (!m->has_method(name)) {
+            m->add_method(method_ptr_t(new method(name, m->get_symbols())));
+         }
+
+         if (!read_trees(r, remap, m->get_method(name))) {
+            return false;
+         }
+      }
+
+      if (!r.read(count)) {
+         return false;
+      }
+
+      for (uint32_t i = 0; i < count; ++i) {
+         module_import import;
+
+         uint32_t names;
+         if (!r.read_string(import.module) || !r.read(import.offset) || !r.read(names)) {
+            return false;
+         }
+
+         for (uint32_t n = 0; n < names; ++n) {
+            if (!r.read_string(name)) {
+               return false;
+            }
+
+            import.names.push_back(name);
+         }
+
+         m->add_import(import);
+      }
+
+      return true;
+   }
+};
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* MODULE_CACHE_H_ */
@@ -0,0 +1,394 @@
+/*
+ * module_interface.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef MODULE_INTERFACE_H_
+#define MODULE_INTERFACE_H_
+
+#include <sstream>
+
+#include "binary_io.h"
+#include "module.h"
+
+namespace amalgam {
+namespace parser {
+
+/**
+ * What a module offers to the modules which import from it: the types it
+ * defines, the variables at its top level, and the signatures of its
+ * methods, grouped into overload sets by name.
+ *
+ * Interfaces are saved next to the module's source once it has been
+ * verified, keyed by a hash of the source like module_cache. What a
+ * module exports also depends on what it imports, so an interface records
+ * the modules it imports from, each with the key of its interface at the
+ * time, and is only current while those are too. Importing from a module
+ * whose interface is current only has to load it, rather than parse and
+ * verify the module again.
+ */
+class module_interface {
+public:
+   /** The type for the modules an interface depends on: the path of each,
+    * with the key of its interface. */
+   typedef std::vector<std::pair<string, uint64_t> > dependency_list_t;
+
+private:
+   /** Bumped whenever the layout changes. */
+   static const uint32_t interface_version = 2;
+
+   dependency_list_t dependencies;
+
+   type_annotation::map_t types;
+
+   type_annotation::map_t variables;
+
+   std::map<string, type_annotation::list_t> methods;
+
+   //=====----------------------------------------------------------------------======//
+   //      Type Annotations
+   //=====----------------------------------------------------------------------======//
+
+   // The classes of type annotation have no virtual functions, so which
+   // one an annotation is follows from its type_id.
+
+   static auto
+   is_numeric(type_annotation::type_id id) -> bool {
+      return id == type_annotation::type_id::integer || id == type_annotation::type_id::floating_point;
+   }
+
+   static auto
+   is_composite(type_annotation::type_id id) -> bool {
+      return id == type_annotation::type_id::astruct || id == type_annotation::type_id::tuple
+             || id == type_annotation::type_id::dict;
+   }
+
+   static void
+   write_list(std::ostream &out, const type_annotation::list_ptr_t &l) {
+      write_binary(out, uint8_t(l ? 1 : 0));
+      if (!l) {
+         return;
+      }
+
+      write_binary(out, uint32_t(l->size()));
+      for (auto &t : *l) {
+         write_type(out, *t);
+      }
+   }
+
+   static void
+   write_type(std::ostream &out, const type_annotation &t) {
+      write_binary(out, uint8_t(t.id));
+      write_binary_string(out, t.name);
+      write_binary(out, uint8_t(t.is_constant));
+      write_binary(out, uint8_t(t.is_vector));
+      write_binary(out, uint8_t(t.is_array));
+      write_binary(out, t.size_in_elements);
+
+      if (is_numeric(t.id)) {
+         auto &n = static_cast<const numeric_type_annotation &>(t);
+         write_binary(out, uint8_t(n.is_signed));
+         write_binary(out, n.size_in_bits);
+         write_binary_string(out, n.specifier);
+      } else if (is_composite(t.id)) {
+         write_list(out, static_cast<const composite_type_annotation &>(t).children);
+      } else if (t.id == type_annotation::type_id::method) {
+         auto &m = static_cast<const method_type_annotation &>(t);
+         write_list(out, m.input);
+         write_list(out, m.output);
+      }
+   }
+
+   static auto
+   read_list(binary_reader &r, type_annotation::list_ptr_t &l) -> bool {
+      uint8_t present;
+      if (!r.read(present)) {
+         return false;
+      }
+
+      if (!present) {
+         l.reset();
+         return true;
+      }
+
+      uint32_t count;
+      if (!r.read(count)) {
+         return false;
+      }
+
+      l.reset(new type_annotation::list_t());
+      for (uint32_t i = 0; i < count; ++i) {
+         auto t = read_type(r);
+         if (!t) {
+            return false;
+         }
+
+         l->push_back(t);
+      }
+
+      return true;
+   }
+
+   /** Reads an annotation written by write_type(), or returns nullptr if
+    * the file is damaged. */
+   static auto
+   read_type(binary_reader &r) -> type_annotation::ptr_t {
+      uint8_t id;
+      if (!r.read(id) || id > uint8_t(type_annotation::type_id::generic)) {
+         return nullptr;
+      }
+
+      auto tid = type_annotation::type_id(id);
+      type_annotation::ptr_t t;
+
+      if (is_numeric(tid)) {
+         t.reset(new numeric_type_annotation(tid));
+      } else if (is_composite(tid)) {
+         t.reset(new composite_type_annotation(tid));
+      } else if (tid == type_annotation::type_id::method) {
+         t.reset(new method_type_annotation());
+      } else {
+         t.reset(new type_annotation(tid));
+      }
+
+      uint8_t is_constant, is_vector, is_array;
+      if (!r.read_string(t->name) || !r.read(is_constant) || !r.read(is_vector) || !r.read(is_array)
+          || !r.read(t->size_in_elements)) {
+         return nullptr;
+      }
+
+      t->is_constant = is_constant;
+      t->is_vector = is_vector;
+      t->is_array = is_array;
+
+      if (is_numeric(tid)) {
+         auto &n = static_cast<numeric_type_annotation &>(*t);
+         uint8_t is_signed;
+         if (!r.read(is_signed) || !r.read(n.size_in_bits) || !r.read_string(n.specifier)) {
+            return nullptr;
+         }
+
+         n.is_signed = is_signed;
+      } else if (is_composite(tid)) {
+         if (!read_list(r, static_cast<composite_type_annotation &>(*t).children)) {
+            return nullptr;
+         }
+      } else if (tid == type_annotation::type_id::method) {
+         auto &m = static_cast<method_type_annotation &>(*t);
+         if (!read_list(r, m.input) || !read_list(r, m.output)) {
+            return nullptr;
+         }
+      }
+
+      return t;
+   }
+
+   /** Copies an annotation, including any lists it owns. */
+   static auto
+   copy_type(const type_annotation &t) -> type_annotation::ptr_t {
+      std::ostringstream out;
+      write_type(out, t);
+
+      auto s = out.str();
+      binary_reader r = { s.data(), s.data() + s.size() };
+
+      return read_type(r);
+   }
+
+public:
+   /** Gets the interface of a verified module. */
+   static auto
+   extract(module_ptr_t m) -> module_interface {
+      module_interface i;
+
+      for (auto &t : m->get_type_map()) {
+         i.types[t.second->name] = t.second;
+      }
+
+      for (auto &v : m->get_method("__default__")->get_variables()) {
+         i.variables[m->get_symbols()->name(v.first)] = v.second;
+      }
+
+      for (auto &it : m->get_method_map()) {
+         auto &name = it.second->get_name();
+         if (name != "__default__") {
+            i.methods[name].push_back(copy_type(it.second->get_type()));
+         }
+      }
+
+      return i;
+   }
+
+   /** Combines the hash of a module's source with the keys of the
+    * interfaces it depends on, giving the key of its own interface. */
+   static auto
+   key(uint64_t hash, const dependency_list_t &dependencies) -> uint64_t {
+      for (auto &d : dependencies) {
+         hash = hash_bytes(d.first.data(), d.first.size(), hash);
+         hash = hash_bytes(reinterpret_cast<const char *>(&d.second), sizeof(d.second), hash);
+      }
+
+      return hash;
+   }
+
+   /** Gets the modules this interface depends on. */
+   auto
+   get_dependencies() const -> const dependency_list_t & {
+      return dependencies;
+   }
+
+   /** Sets the modules this interface depends on. */
+   void
+   set_dependencies(const dependency_list_t &d) {
+      dependencies = d;
+   }
+
+   /** Writes the interface to path. Returns false if the file could not
+    * be written; see save_binary_file(). */
+   auto
+   save(const string &path, uint64_t hash) const -> bool {
+      return save_binary_file(path, [&](std::ostream &out) {
+         write(out, hash);
+      });
+   }
+
+private:
+   void
+   write(std::ostream &out, uint64_t hash) const {
+      write_binary_header(out, "AMIF", interface_version, hash);
+
+      write_binary(out, uint32_t(dependencies.size()));
+      for (auto &d : dependencies) {
+         write_binary_string(out, d.first);
+         write_binary(out, d.second);
+      }
+
+      for (auto map : { &types, &variables }) {
+         write_binary(out, uint32_t(map->size()));
+         for (auto &it : *map) {
+            write_binary_string(out, it.first);
+            write_type(out, *it.second);
+         }
+      }
+
+      write_binary(out, uint32_t(methods.size()));
+      for (auto &it : methods) {
+         write_binary_string(out, it.first);
+         write_binary(out, uint32_t(it.second.size()));
+         for (auto &t : it.second) {
+            write_type(out, *t);
+         }
+      }
+   }
+
+public:
+   /** Reads an interface written by save() into this one, which must be
+    * empty. Returns false if there is no interface at path, or it was
+    * saved from a different source. Whether the interfaces it depends on
+    * have changed is left to the caller. */
+   auto
+   load(const string &path, uint64_t hash) -> bool {
+      std::unique_ptr<pegtl::file_mapper> file;
+
+      try {
+         file.reset(new pegtl::file_mapper(path));
+      } catch (const pegtl::parse_error &) {
+         return false;
+      }
+
+      binary_reader r = { file->data(), file->data() + file->size() };
+      if (!r.read_header("AMIF", interface_version, hash)) {
+         return false;
+      }
+
+      uint32_t count;
+      string name;
+
+      if (!r.read(count)) {
+         return false;
+      }
+
+      for (uint32_t i = 0; i < count; ++i) {
+         uint64_t key;
+         if (!r.read_string(name) || !r.read(key)) {
+            return false;
+         }
+
+         dependencies.push_back(std::make_pair(name, key));
+      }
+
+      for (auto map : { &types, &variables }) {
+         if (!r.read(count)) {
+            return false;
+         }
+
+         for (uint32_t i = 0; i < count; ++i) {
+            if (!r.read_string(name) || !((*map)[name] = read_type(r))) {
+               return false;
+            }
+         }
+      }
+
+      if (!r.read(count)) {
+         return false;
+      }
+
+      for (uint32_t i = 0; i < count; ++i) {
+         uint32_t overloads;
+         if (!r.read_string(name) || !r.read(overloads)) {
+            return false;
+         }
+
+         auto &set = methods[name];
+         for (uint32_t j = 0; j < overloads; ++j) {
+            auto t = read_type(r);
+            if (!t) {
+               return false;
+            }
+
+            set.push_back(t);
+         }
+      }
+
+      return true;
+   }
+
+   /** Makes one exported name available in m: a type is added to its
+    * types, a variable to its top level, and every overload of a method
+    * to its imported methods. Each is interned in m's type context, so
+    * that it compares equal to the same type made in m. Returns false if
+    * nothing by that name is exported. */
+   auto
+   import_into(module_ptr_t m, const string &name) const -> bool {
+      auto found = false;
+
+      auto t = types.find(name);
+      if (t != types.end()) {
+         m->add_type(m->get_type_context().intern(copy_type(*t->second)));
+         found = true;
+      }
+
+      auto v = variables.find(name);
+      if (v != variables.end()) {
+         m->get_method("__default__")->add_variable(m->get_symbols()->intern(name),
+                                                   m->get_type_context().intern(copy_type(*v->second)));
+         found = true;
+      }
+
+      auto f = methods.find(name);
+      if (f != methods.end()) {
+         for (auto &signature : f->second) {
+            m->add_imported_method(name, m->get_type_context().intern(copy_type(*signature)));
+         }
+         found = true;
+      }
+
+      return found;
+   }
+};
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* MODULE_INTERFACE_H_ */
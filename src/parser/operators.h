@@ -0,0 +1,105 @@
+/*
+ * operators.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef OPERATORS_H_
+#define OPERATORS_H_
+
+#include <vector>
+
+#include "symbols.h"
+
+namespace amalgam {
+namespace parser {
+
+/** How an operator groups with other operators of the same precedence. */
+enum class associativity {
+   left,
+   right
+};
+
+/** Describes how a binary operator binds. */
+struct operator_info {
+   /** Operators with higher precedence bind more tightly. Zero means the
+    * symbol is not an operator. */
+   int precedence;
+
+   /** How the operator groups with operators of the same precedence. */
+   associativity assoc;
+};
+
+/**
+ * Maps operator symbols to their precedence and associativity. The
+ * table starts out with every builtin operator the generator knows how
+ * to emit.
+ */
+class operator_table {
+   /** Indexed by symbol. */
+   std::vector<operator_info> ops;
+
+public:
+   operator_table() {
+      add(builtin_symbol::mul, 12);
+      add(builtin_symbol::div, 12);
+      add(builtin_symbol::rem, 12);
+
+      add(builtin_symbol::add, 11);
+      add(builtin_symbol::sub, 11);
+
+      add(builtin_symbol::shl, 10);
+      add(builtin_symbol::shr, 10);
+
+      add(builtin_symbol::lt, 9);
+      add(builtin_symbol::le, 9);
+      add(builtin_symbol::gt, 9);
+      add(builtin_symbol::ge, 9);
+
+      add(builtin_symbol::eq, 8);
+      add(builtin_symbol::ne, 8);
+
+      add(builtin_symbol::bit_and, 7);
+      add(builtin_symbol::bit_xor, 6);
+      add(builtin_symbol::bit_or, 5);
+
+      // 2 to 4 are left for the operators declared in lib/syntax.
+
+      add(builtin_symbol::init, 1, associativity::right);
+   }
+
+   /** Adds or replaces an operator. */
+   void
+   add(symbol_t op, int precedence, associativity assoc = associativity::left) {
+      if (op >= ops.size()) {
+         operator_info none = { 0, associativity::left };
+         ops.resize(op + 1, none);
+      }
+
+      ops[op].precedence = precedence;
+      ops[op].assoc = assoc;
+   }
+
+   /** Indicates if the symbol is a known operator. */
+   auto
+   is_operator(symbol_t op) const -> bool {
+      return op < ops.size() && ops[op].precedence > 0;
+   }
+
+   /** Gets the binding of an operator. The symbol must be an operator. */
+   auto
+   get(symbol_t op) const -> const operator_info & {
+      return ops[op];
+   }
+
+   /** One more than the highest symbol in the table. */
+   auto
+   size() const -> std::size_t {
+      return ops.size();
+   }
+};
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* OPERATORS_H_ */
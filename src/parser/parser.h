@@ -8,6 +8,18 @@
 #ifndef PARSER_H_
 #define PARSER_H_
 
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "folder.h"
+#include "module_cache.h"
+#include "module_interface.h"
 #include "rules.h"
 #include "verifier.h"
 
@@ -16,27 +28,515 @@ namespace parser {
 
 class parser {
 
-public:
+   /** The operators and statement forms the grammar accepts. */
+   syntax_table_ptr_t syntax;
+
+   /** Where to print a profile of the grammar rules after each parse, or
+    * nullptr to parse at full speed. */
+   std::ostream* profile;
+
+   /** Whether to carry on after a syntax error and report every error in
+    * the input, rather than stopping at the first one. */
+   bool recover;
+
+   /** Whether parse_file() keeps the trees it parses in a cache next to
+    * each file, and loads them from there while the file is unchanged. */
+   bool caching;
+
+   /** How many methods of a module are verified at once. */
+   unsigned verify_threads;
+
+   /** The methods of each file which passed verification, so that parsing
+    * a file again only verifies the methods which changed. */
+   verification_cache verified;
+
+   /** The directories searched for imported modules, after the directory
+    * of the module which imports them. */
+   std::vector<std::string> search_path;
+
+   /** The files being verified, innermost last, so that a module which
+    * ends up importing itself is caught rather than parsed forever. */
+   std::vector<std::string> importing;
+
+   /** The key of the current interface of each file whose interface has
+    * been loaded or saved, for the interfaces which depend on it. */
+   std::map<std::string, uint64_t> interface_keys;
+
+   /** Creates an empty module which knows the symbols of the syntax. A
+    * module parsed from a file shares its type context with the earlier
+    * parses of the file, so that their verified methods can be reused. */
+   auto
+   make_module(const std::string& name, const std::string& path = std::string()) -> module_ptr_t {
+      auto types = path.empty() ? type_context_ptr_t() : verified.get_type_context(path);
+      return module_ptr_t(new module(name, path, syntax->make_symbols(), types));
+   }
+
+   /** Gets the name of the module stored at path: the file name without
+    * its directory or extension. */
+   static auto
+   module_name(const std::string& path) -> std::string {
+      auto start = path.find_last_of('/');
+      start = (start == std::string::npos) ? 0 : start + 1;
+
+      auto end = path.find_last_of('.');
+      if (end == std::string::npos || end < start) {
+         end = path.size();
+      }
+
+      return path.substr(start, end - start);
+   }
 
+   /** Parses in with Grammar, profiling it if asked to. */
+   template<typename Grammar, typename Input>
+      void
+      parse_input(Input& in, expression_builder& b, module_ptr_t m) {
+         if (profile) {
+            pegtl::profile_debug de(pegtl::tag<Grammar>(0));
+            pegtl::parse<Grammar>(in, de, b, m);
+            de.report(*profile);
+         } else if (recover) {
+            // Failed attempts are expected while recovering, so they are
+            // not logged.
+            pegtl::dummy_parse<Grammar>(in, b, m);
+         } else {
+            pegtl::basic_parse<Grammar>(in, b, m);
+         }
+      }
+
+   /** Prints the module's diagnostics, from the first'th on, the way the
+    * verifier prints its errors. */
+   void
+   print_diagnostics(module_ptr_t m, std::size_t first = 0) {
+      auto& diagnostics = m->get_diagnostics();
+      for (auto d = diagnostics.begin() + first; d != diagnostics.end(); ++d) {
+         std::cout << "error: ";
+         if (!m->get_path().empty()) {
+            std::cout << m->get_path() << ":";
+         }
+         if (d->line != 0) {
+            std::cout << d->line << ":" << d->column << ": ";
+         }
+         std::cout << d->message << std::endl;
+      }
+   }
+
+   /** Works out the line and column of each of the module's diagnostics,
+    * from the first'th on. */
+   void
+   locate_diagnostics(module_ptr_t m, memory_source_ptr_t src, std::size_t first = 0) {
+      std::size_t line = src->first_line(), column = 1;
+      uint64_t at = src->base();
+
+      // Diagnostics are added in the order of the input, so one pass over
+      // the text finds every position.
+      auto& diagnostics = m->get_diagnostics();
+      for (auto it = diagnostics.begin() + first; it != diagnostics.end(); ++it) {
+         auto& d = *it;
+         for (; at < d.offset && at < src->base() + src->size(); ++at) {
+            if (*src->at(at, 1) == '\n') {
+               ++line;
+               column = 1;
+            } else {
+               ++column;
+            }
+         }
+
+         d.line = line;
+         d.column = column;
+      }
+   }
+
+   /** Parses src into the module, without verifying it. */
    module_ptr_t
-   parse(const std::string& s, bool verbose = false) {
-      auto m = module_ptr_t(new module("__main__"));
-      ast_stack_t t;
+   parse_module(module_ptr_t m, memory_source_ptr_t src) {
+      m->set_source(src);
+
+      expression_builder b(*syntax);
+
+      // Lex the module's own copy of the text, so that nodes can refer
+      // into it by offset.
+      auto tokens = lex(src->data(), src->data() + src->size(), *m->get_symbols());
+      parser_input in(tokens);
+
+      if (recover) {
+         parse_input<recovering_grammar>(in, b, m);
+         locate_diagnostics(m, src);
+         print_diagnostics(m);
+      } else {
+         parse_input<grammar>(in, b, m);
+      }
+
+      return m;
+   }
+
+   /** Finds the file of an imported module: a.b is a/b.am, looked for in
+    * the importer's directory and then along the search path. Returns an
+    * empty string if there is no such file. */
+   auto
+   find_module(const module_import& i, module_ptr_t importer) -> std::string {
+      auto relative = i.module;
+      std::replace(relative.begin(), relative.end(), '.', '/');
+      relative += ".am";
+
+      auto& path = importer->get_path();
+      auto slash = path.find_last_of('/');
+
+      std::vector<std::string> dirs;
+      dirs.push_back(slash == std::string::npos ? std::string() : path.substr(0, slash));
+      dirs.insert(dirs.end(), search_path.begin(), search_path.end());
+
+      for (auto& dir : dirs) {
+         auto candidate = dir.empty() ? relative : dir + "/" + relative;
+         if (std::ifstream(candidate.c_str())) {
+            return candidate;
+         }
+      }
+
+      return std::string();
+   }
+
+   /** Loads the interface file of the module at path, if it is current:
+    * the module's source is unchanged, and so is the interface of every
+    * module it depends on. */
+   auto
+   load_current_interface(const std::string& path, module_interface& i) -> bool {
+      mapped_source src(path);
+      auto hash = module_cache::hash(src.data(), src.size(), syntax->get_fingerprint());
+
+      if (!i.load(path + ".interface", hash)) {
+         return false;
+      }
+
+      for (auto& d : i.get_dependencies()) {
+         module_interface dep;
+         if (!load_interface(d.first, dep) || interface_keys[d.first] != d.second) {
+            return false;
+         }
+      }
+
+      interface_keys[path] = module_interface::key(hash, i.get_dependencies());
+      return true;
+   }
+
+   /** Gets the interface of the module at path. It is loaded from the
+    * interface file next to the module while that is current, and
+    * otherwise the module is parsed and verified, which saves a fresh
+    * interface file. Returns false if the module fails, or is already
+    * being verified. */
+   auto
+   load_interface(const std::string& path, module_interface& i) -> bool {
+      if (std::find(importing.begin(), importing.end(), path) != importing.end()) {
+         return false;
+      }
+
+      if (caching && !profile) {
+         // Checking the interfaces it depends on may lead back here, so
+         // the module counts as being verified meanwhile.
+         importing.push_back(path);
+
+         bool current;
+         try {
+            current = load_current_interface(path, i);
+         } catch (...) {
+            importing.pop_back();
+            throw;
+         }
+
+         importing.pop_back();
+         if (current) {
+            return true;
+         }
+
+         // A failed load may have left part of an interface behind.
+         i = module_interface();
+      }
+
+      auto dep = parse_file(path);
+      if (!dep) {
+         return false;
+      }
+
+      i = module_interface::extract(dep);
+      return true;
+   }
+
+   /** Makes the names imported by the module's import statements available
+    * to it. Each import which fails is added to the module's diagnostics,
+    * at the import statement, and printed. Returns false if any fails. */
+   auto
+   resolve_imports(module_ptr_t m) -> bool {
+      auto first = m->get_diagnostics().size();
+
+      for (auto& i : m->get_imports()) {
+         auto path = find_module(i, m);
+         if (path.empty()) {
+            m->add_diagnostic(i.offset, "unable to find module '" + i.module + "'");
+            continue;
+         }
+
+         if (std::find(importing.begin(), importing.end(), path) != importing.end()) {
+            m->add_diagnostic(i.offset, "module '" + i.module + "' imports itself");
+            continue;
+         }
+
+         module_interface interface;
+         if (!load_interface(path, interface)) {
+            m->add_diagnostic(i.offset, "unable to import from module '" + i.module + "'");
+            continue;
+         }
+
+         for (auto& name : i.names) {
+            if (!interface.import_into(m, name)) {
+               m->add_diagnostic(i.offset, "module '" + i.module + "' has no export named '" + name + "'");
+            }
+         }
+      }
+
+      if (m->get_diagnostics().size() == first) {
+         return true;
+      }
 
-      pegtl::basic_parse_string<grammar>(s, t, m);
+      auto src = std::dynamic_pointer_cast<memory_source>(m->get_source());
+      if (src) {
+         locate_diagnostics(m, src, first);
+      }
 
+      print_diagnostics(m, first);
+      return false;
+   }
+
+   /** Verifies a module which has been parsed, and folds its constants.
+    * Returns nullptr if it fails. */
+   module_ptr_t
+   verify_module(module_ptr_t m, bool verbose) {
       if (verbose) {
          m->dump();
       }
 
-      verifier v;
+      if (!resolve_imports(m)) {
+         return nullptr;
+      }
+
+      verifier v(verify_threads);
+      v.set_cache(&verified);
 
       if (!v.verify(m, verbose)) {
          return nullptr;
       }
 
+      folder f;
+      f.fold(m);
+
       return m;
    }
+
+   /** Verifies the module parsed from the file at path, noting that the
+    * file is being verified while its imports are resolved. */
+   module_ptr_t
+   verify_file(const std::string& path, module_ptr_t m, bool verbose) {
+      importing.push_back(path);
+
+      try {
+         m = verify_module(m, verbose);
+      } catch (...) {
+         importing.pop_back();
+         throw;
+      }
+
+      importing.pop_back();
+      return m;
+   }
+
+public:
+   /** Creates a parser which only knows the builtin operators. */
+   parser() :
+            syntax(new syntax_table()), profile(nullptr), recover(false), caching(true), verify_threads(1) {
+   }
+
+   /** Creates a parser for the syntax in a table, usually one loaded with
+    * syntax_table::load_directory(). */
+   parser(syntax_table_ptr_t _syntax) :
+            syntax(_syntax), profile(nullptr), recover(false), caching(true), verify_threads(1) {
+   }
+
+   /** Turns on profiling. After every parse of a string or a file, the
+    * number of times each grammar rule was attempted and succeeded, the
+    * bytes it consumed, and the bytes it re-scanned after backtracking
+    * are printed to out, the most often attempted rules first. Passing
+    * nullptr turns profiling off again. */
+   void
+   set_profiling(std::ostream* out) {
+      profile = out;
+   }
+
+   /** Turns on error recovery. A statement with a syntax error no longer
+    * stops the parse: the error is added to the module's diagnostics and
+    * printed, the rest of its line is skipped, and parsing carries on
+    * with the next line. The statements which did parse are still
+    * verified, so the module is returned unless verification fails;
+    * check has_diagnostics() to find out whether anything was skipped. */
+   void
+   set_recovery(bool on) {
+      recover = on;
+   }
+
+   /** Turns the cache parse_file() keeps next to each file on or off. It
+    * is on by default. */
+   void
+   set_caching(bool on) {
+      caching = on;
+   }
+
+   /** Sets how many methods of a module are verified at once. Zero means
+    * one per core. Errors are reported in the same order either way. */
+   void
+   set_verification_threads(unsigned n) {
+      verify_threads = n;
+   }
+
+   /** Sets the directories searched for imported modules. The directory
+    * of the importing module is always searched first. */
+   void
+   set_search_path(const std::vector<std::string>& dirs) {
+      search_path = dirs;
+   }
+
+   module_ptr_t
+   parse(const std::string& s, bool verbose = false) {
+      return verify_module(parse_unverified(s), verbose);
+   }
+
+   /** Parses a string without verifying the result. Meant for tools, such
+    * as benchmarks, which need to look at parsing on its own. */
+   module_ptr_t
+   parse_unverified(const std::string& s) {
+      auto m = make_module("__main__");
+
+      return parse_module(m, memory_source_ptr_t(new string_source(s)));
+   }
+
+   /** Parses the file at path. The file is mapped into memory and parsed
+    * in place rather than being read into a string first.
+    *
+    * Unless caching has been turned off, the trees are saved to
+    * path + ".cache", and are loaded from there instead of parsing the
+    * file again for as long as neither the file nor the syntax changes.
+    * Files with syntax errors are not cached, so that the errors are
+    * reported every time, and neither is anything while profiling. Once
+    * the module verifies, its interface is saved to path + ".interface"
+    * for the modules which import from it. */
+   module_ptr_t
+   parse_file(const std::string& path, bool verbose = false) {
+      auto m = make_module(module_name(path), path);
+      auto src = memory_source_ptr_t(new mapped_source(path));
+
+      if (!caching || profile) {
+         return verify_file(path, parse_module(m, src), verbose);
+      }
+
+      auto cache_path = path + ".cache";
+      auto hash = module_cache::hash(src->data(), src->size(), syntax->get_fingerprint());
+
+      if (module_cache::load(m, cache_path, hash)) {
+         m->set_source(src);
+      } else {
+         // A failed load may have left trees behind, so start over.
+         m = make_module(module_name(path), path);
+         parse_module(m, src);
+
+         if (!m->has_diagnostics()) {
+            module_cache::save(m, cache_path, hash);
+         }
+      }
+
+      m = verify_file(path, m, verbose);
+      if (!m) {
+         return m;
+      }
+
+      // Resolving the imports noted the key of each interface they came
+      // from.
+      module_interface::dependency_list_t dependencies;
+      for (auto& i : m->get_imports()) {
+         auto dep = find_module(i, m);
+         dependencies.push_back(std::make_pair(dep, interface_keys[dep]));
+      }
+
+      auto interface_path = path + ".interface";
+      module_interface current;
+      if (!current.load(interface_path, hash) || current.get_dependencies() != dependencies) {
+         auto fresh = module_interface::extract(m);
+         fresh.set_dependencies(dependencies);
+         fresh.save(interface_path, hash);
+      }
+
+      interface_keys[path] = module_interface::key(hash, dependencies);
+      return m;
+   }
+
+   /**
+    * Parses a stream, such as a pipe, one statement at a time. Each
+    * statement is parsed into a module of its own, verified, and handed
+    * to the handler as soon as it is complete; statements which fail
+    * verification are handed over as nullptr, just as parse() returns.
+    * Statements are single lines, read through a buffer_input which only
+    * keeps the current line, so memory use does not grow with the input.
+    *
+    * A statement with a syntax error is reported, with its line and
+    * column in the stream, and handed over as nullptr, whether or not
+    * recovery is on: it never stops the statements after it.
+    */
+   void
+   parse_stream(std::istream& s, const std::function<void(module_ptr_t)>& handler, bool verbose = false) {
+      typedef std::istreambuf_iterator<char> stream_iterator;
+      pegtl::buffer_input<stream_iterator, pegtl::offset_location> stream((stream_iterator(s)), stream_iterator());
+
+      std::string line;
+      std::size_t number = 1;
+
+      while (!stream.eof()) {
+         auto offset = stream.offset(stream.here());
+         pegtl::dummy_parse<lexer_grammar::stream_line>(stream, line);
+
+         auto m = make_module("__main__");
+         auto src = memory_source_ptr_t(new line_source(line, offset, number++));
+         m->set_source(src);
+
+         auto tokens = lex(src->data(), src->data() + src->size(), *m->get_symbols(), offset);
+         parser_input in(tokens);
+
+         expression_builder b(*syntax);
+         if (recover) {
+            pegtl::dummy_parse<recover_statement>(in, b, m);
+         } else {
+            // The error is reported as a diagnostic below, so the failed
+            // rules are not logged.
+            try {
+               pegtl::dummy_parse<statement>(in, b, m);
+            } catch (const pegtl::parse_error&) {
+               // The builder may hold part of the statement, so the error
+               // is looked for from scratch.
+               expression_builder fresh(*syntax);
+               in.rewind();
+               locate_syntax_error(in, fresh, m);
+            }
+         }
+
+         if (m->has_diagnostics()) {
+            locate_diagnostics(m, src);
+            print_diagnostics(m);
+            handler(nullptr);
+            continue;
+         }
+
+         // Skip blank lines.
+         if (m->get_current_method()->get_flat_tree().get_roots().empty()) {
+            continue;
+         }
+
+         handler(verify_module(m, verbose));
+      }
+   }
 };
 
 } // end parser namespace
@@ -4,6 +4,7 @@
 #ifndef COHI_PEGTL_HH
 #define COHI_PEGTL_HH
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
@@ -25,6 +26,15 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <string.h>
+
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#endif
 
 #include <sys/stat.h>
 #include <sys/mman.h>
@@ -43,6 +53,7 @@
 #include "pegtl/debug_print.hh"
 #include "pegtl/debug_basic.hh"
 #include "pegtl/debug_trace.hh"
+#include "pegtl/debug_profile.hh"
 
 #include "pegtl/parse_generic.hh"
 #include "pegtl/parse_iterator.hh"
@@ -54,5 +65,6 @@
 #include "pegtl/rules_extended.hh"
 #include "pegtl/rules_special.hh"
 #include "pegtl/rules_string.hh"
+#include "pegtl/rules_memo.hh"
 
 #endif
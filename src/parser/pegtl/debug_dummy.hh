@@ -42,6 +42,42 @@ namespace pegtl
       }
    };
 
+   // Class furthest_debug is a dummy_debug which also remembers the
+   // furthest position in the input at which any rule was attempted.
+   // When a parse fails, that is usually where the actual error is, since
+   // every alternative which got past it has been tried.
+
+   struct furthest_debug : public dummy_debug
+   {
+      explicit
+      furthest_debug( const size_t start = 0 )
+	    : m_furthest( start )
+      { }
+
+      template< bool Must, typename Rule, typename Input, typename ... States >
+      bool match( Input & in, States && ... st )
+      {
+	 m_furthest = std::max( m_furthest, in.offset( in.here() ) );
+
+	 if ( Rule::template match< Must >( in, * this, std::forward< States >( st ) ... ) ) {
+	    m_furthest = std::max( m_furthest, in.offset( in.here() ) );
+	    return true;
+	 }
+	 else if ( Must ) {
+	    PEGTL_THROW( "required rule " << demangle< Rule >() << " failed" );
+	 }
+	 return false;
+      }
+
+      size_t furthest() const
+      {
+	 return m_furthest;
+      }
+
+   private:
+      size_t m_furthest;
+   };
+
 } // pegtl
 
 #endif
@@ -0,0 +1,158 @@
+// Copyright (c) 2008 Dr. Colin Hirsch
+// Please see license.txt for license.
+
+#ifndef COHI_PEGTL_HH
+#error "Please #include only pegtl.hh (rather than individual pegtl_*.hh files)."
+#endif
+
+#ifndef COHI_PEGTL_DEBUG_PROFILE_HH
+#define COHI_PEGTL_DEBUG_PROFILE_HH
+
+
+namespace pegtl
+{
+   // Class profile_debug behaves like basic_debug, and additionally keeps
+   // statistics for every rule: how often it was attempted and succeeded,
+   // how many bytes its successful matches consumed, and how many of those
+   // bytes it had already consumed before, i.e. was made to re-scan after
+   // some enclosing rule backtracked.
+
+   // Only the outermost active invocation of a recursive rule counts
+   // towards re-scanning, so that the outer match of an expression is not
+   // charged for the inner expressions it contains.
+
+   struct rule_profile
+   {
+      rule_profile()
+	    : attempts( 0 ),
+	      successes( 0 ),
+	      consumed( 0 ),
+	      rescanned( 0 ),
+	      furthest( 0 ),
+	      active( 0 )
+      { }
+
+      std::string name;
+
+      unsigned long attempts;
+      unsigned long successes;
+      unsigned long consumed;
+      unsigned long rescanned;
+
+      // The end of the furthest match so far, and the number of
+      // invocations currently in progress.
+
+      size_t furthest;
+      unsigned active;
+   };
+
+   inline size_t next_profile_index()
+   {
+      static size_t next = 0;
+      return next++;
+   }
+
+   template< typename Rule >
+   size_t profile_index()
+   {
+      static const size_t index = next_profile_index();
+      return index;
+   }
+
+   struct profile_debug : public debug_base
+   {
+      template< typename TopRule >
+      explicit
+      profile_debug( const tag< TopRule > & help )
+	    : m_printer( help )
+      { }
+
+      template< bool Must, typename Rule, typename Input, typename ... States >
+      bool match( Input & in, States && ... st )
+      {
+	 // Nested matches may grow m_rules, so the entry is looked up again
+	 // rather than held by reference.
+
+	 const size_t i = profile_index< Rule >();
+	 if ( i >= m_rules.size() ) {
+	    m_rules.resize( i + 1 );
+	 }
+	 if ( m_rules[ i ].name.empty() ) {
+	    m_rules[ i ].name = demangle< Rule >();
+	 }
+	 ++m_rules[ i ].attempts;
+	 ++m_rules[ i ].active;
+
+	 const size_t begin = in.offset( in.here() );
+	 const basic_guard< Rule, Input, profile_debug > d( in.location(), m_counter );
+	 bool result;
+
+	 try {
+	    result = d( Rule::template match< Must >( in, * this, std::forward< States >( st ) ... ), Must );
+	 }
+	 catch ( const parse_error & ) {
+	    --m_rules[ i ].active;
+	    PEGTL_LOGGER( * this, "#" << m_counter.nest() << " @" << d.location() << ": " << m_printer.template rule< Rule >() );
+	    throw;
+	 }
+
+	 rule_profile & p = m_rules[ i ];
+	 --p.active;
+
+	 if ( result ) {
+	    const size_t end = in.offset( in.here() );
+
+	    ++p.successes;
+	    p.consumed += end - begin;
+
+	    if ( p.active == 0 ) {
+	       if ( p.furthest > begin ) {
+		  p.rescanned += std::min( end, p.furthest ) - begin;
+	       }
+	       p.furthest = std::max( p.furthest, end );
+	    }
+	 }
+	 return result;
+      }
+
+      // Returns the statistics for Rule, or 0 if it was never attempted.
+
+      template< typename Rule >
+      const rule_profile * find() const
+      {
+	 const size_t i = profile_index< Rule >();
+	 return ( ( i < m_rules.size() ) && m_rules[ i ].attempts ) ? & m_rules[ i ] : 0;
+      }
+
+      // Prints one line per rule, the most often attempted first.
+
+      void report( std::ostream & o ) const
+      {
+	 std::vector< const rule_profile * > sorted;
+
+	 for ( size_t i = 0; i < m_rules.size(); ++i ) {
+	    if ( m_rules[ i ].attempts ) {
+	       sorted.push_back( & m_rules[ i ] );
+	    }
+	 }
+	 std::sort( sorted.begin(), sorted.end(), [] ( const rule_profile * a, const rule_profile * b ) {
+	       return ( a->attempts != b->attempts ) ? ( a->attempts > b->attempts ) : ( a->rescanned > b->rescanned );
+	    } );
+
+	 o << std::setw( 12 ) << "attempts" << std::setw( 12 ) << "successes" << std::setw( 12 ) << "consumed" << std::setw( 12 ) << "rescanned" << "  rule\n";
+
+	 for ( size_t i = 0; i < sorted.size(); ++i ) {
+	    const rule_profile & p = * sorted[ i ];
+	    o << std::setw( 12 ) << p.attempts << std::setw( 12 ) << p.successes << std::setw( 12 ) << p.consumed << std::setw( 12 ) << p.rescanned << "  " << p.name << '\n';
+	 }
+      }
+
+   protected:
+      counter m_counter;
+      printer m_printer;
+      std::vector< rule_profile > m_rules;
+   };
+
+} // pegtl
+
+#endif
@@ -27,11 +27,6 @@ namespace pegtl
 	      m_end( end )
       { }
 
-      ~buffer_impl()
-      {
-	 PEGTL_PRINT( "pegtl: buffer runpos " << m_runpos << " vecpos " << m_vecpos << " capacity " << m_vector.capacity() );
-      }
-
       typedef typename std::iterator_traits< Iterator >::value_type value_type;
 
       bool eof( const size_t offset )
@@ -63,7 +58,14 @@ namespace pegtl
 	 //	 PEGTL_DEBUG( m_record << ( m_run == m_end ) << " " << m_runpos << " " << m_vecpos << " " << m_vector.size() << " " << m_count );
 
 	 if ( m_vecpos != offset ) {
-	    m_vector.clear();
+	    // Keep whatever was already read ahead of the new start, it
+	    // can not be fetched from the underlying iterator again.
+	    if ( ( offset > m_vecpos ) && ( offset < m_vecpos + m_vector.size() ) ) {
+	       m_vector.erase( m_vector.begin(), m_vector.begin() + ( offset - m_vecpos ) );
+	    }
+	    else {
+	       m_vector.clear();
+	    }
 	    m_vecpos = offset;
 	 }
 	 m_record = true;
@@ -92,7 +94,7 @@ namespace pegtl
 	 record_true( offset );
       }
 
-      const value_type & operator[] ( const size_t offset )
+      value_type operator[] ( const size_t offset )
       {
 	 //	 PEGTL_DEBUG( offset );
 	 //	 PEGTL_DEBUG( m_record << ( m_run == m_end ) << " " << m_runpos << " " << m_vecpos << " " << m_vector.size() << " " << m_count );
@@ -195,6 +197,11 @@ namespace pegtl
    class buffer_iterator : public std::iterator< std::forward_iterator_tag, typename std::iterator_traits< Iterator >::value_type >
    {
    public:
+      buffer_iterator()
+	    : m_offset( 0 ),
+	      m_buffer( 0 )
+      { }
+
       buffer_iterator( const size_t offset, buffer_impl< Iterator > & buffer )
 	    : m_offset( offset ),
 	      m_buffer( & buffer )
@@ -212,11 +219,6 @@ namespace pegtl
 	 return ( * m_buffer )[ m_offset ];
       }
 
-      const value_type * operator-> () const
-      {
-	 return & operator* ();
-      }
-
       buffer_iterator operator++ ( int )
       {
 	 buffer_iterator nrv( * this );
@@ -237,7 +239,7 @@ namespace pegtl
 
       bool operator!= ( const buffer_iterator & i ) const
       {
-	 return m_offset == i.m_offset;
+	 return m_offset != i.m_offset;
       }
 
    public:
@@ -321,6 +323,11 @@ namespace pegtl
 	 m_run = iter;
       }
 
+      size_t offset( const iterator & iter ) const
+      {
+	 return iter.internal_offset();
+      }
+
    protected:
       mutable buffer_impl< Iterator > m_buffer;
       iterator m_run;
@@ -110,11 +110,24 @@ namespace pegtl
 	 return * this;
       }
 
+      // Only available when Iterator is a pointer.
+
+      void advance( const size_t n )
+      {
+	 m_location.advance( m_iterator, n );
+	 m_iterator += n;
+      }
+
       const Location & location() const
       {
 	 return m_location;
       }
 
+      const Iterator & base() const
+      {
+	 return m_iterator;
+      }
+
       bool operator== ( const forward_iterator & i ) const
       {
 	 return m_iterator == i.m_iterator;
@@ -197,6 +210,32 @@ namespace pegtl
 	 m_run = iter;
       }
 
+      // Only available when Iterator is a random access iterator.
+
+      size_t offset( const iterator & iter ) const
+      {
+	 return iter.base() - m_begin.base();
+      }
+
+      // Only available when Iterator is a pointer: the input is one block
+      // of memory, so rules can scan it directly and then skip over
+      // everything they matched at once.
+
+      const value_type * data() const
+      {
+	 return m_run.base();
+      }
+
+      size_t remaining() const
+      {
+	 return m_end.base() - m_run.base();
+      }
+
+      void skip( const size_t n )
+      {
+	 m_run.advance( n );
+      }
+
       std::string debug_escape( const iterator & begin, const iterator & end ) const
       {
 	 std::string nrv;
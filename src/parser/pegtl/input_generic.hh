@@ -59,6 +59,10 @@ namespace pegtl
 
    // Please see the supplied rule classes for usage examples...
 
+   // Locations are updated one character at a time through operator(), or
+   // in bulk through advance( begin, n ) when an input skips a whole run
+   // of n characters starting at begin.
+
    class dummy_location
    {
    public:
@@ -67,6 +71,9 @@ namespace pegtl
 	 return c;
       }
 
+      void advance( const char *, const size_t )
+      { }
+
       void write_to( std::ostream & o ) const
       {
 	 o << '?';
@@ -87,6 +94,11 @@ namespace pegtl
 	 return c;
       }
 
+      void advance( const char *, const size_t n )
+      {
+	 m_offset += n;
+      }
+
       void write_to( std::ostream & o ) const
       {
 	 o << m_offset;
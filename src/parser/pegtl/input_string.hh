@@ -34,6 +34,19 @@ namespace pegtl
 	 return c;
       }
 
+      void advance( const char * begin, const size_t n )
+      {
+	 const char * run = begin;
+	 const char * const end = begin + n;
+
+	 while ( const void * nl = ::memchr( run, '\n', end - run ) ) {
+	    ++m_line;
+	    m_column = 1;
+	    run = static_cast< const char * >( nl ) + 1;
+	 }
+	 m_column += end - run;
+      }
+
       void write_to( std::ostream & o ) const
       {
 	 o << m_line << "," << m_column;
@@ -75,6 +75,70 @@ namespace pegtl
       }
    };
 
+   // Class match_view describes the input matched by a rule as an offset
+   // from the beginning of the input, plus a length. Actions applied with
+   // ifapply_view receive one of these instead of a std::string, so that
+   // they can refer to the input rather than copy it. The input must
+   // provide offset(), which is the case for forward_input over random
+   // access iterators.
+
+   struct match_view
+   {
+      match_view( const size_t o, const size_t l )
+	    : offset( o ),
+	      length( l )
+      { }
+
+      size_t offset;
+      size_t length;
+   };
+
+   template< typename ... Funcs > struct apply_view_helper;
+
+   template<>
+   struct apply_view_helper<>
+   {
+      template< typename ... States >
+      static void apply( const match_view &, States && ... )
+      { }
+   };
+
+   template< typename Func, typename ... Funcs >
+   struct apply_view_helper< Func, Funcs ... >
+   {
+      template< typename ... States >
+      static void apply( const match_view & v, States && ... st )
+      {
+	 Func::apply( v, std::forward< States >( st ) ... );
+	 apply_view_helper< Funcs ... >::apply( v, std::forward< States >( st ) ... );
+      }
+   };
+
+   template< typename Rule, typename Func, typename ... Funcs >
+   struct ifapply_view
+   {
+      typedef ifapply_view key_type;
+
+      template< typename Print >
+      static void prepare( Print & st )
+      {
+	 prepare2< ifapply_view, Rule, Func, Funcs ... >( st, "( ", " | @", " @", " )" );
+      }
+
+      template< bool Must, typename Input, typename Debug, typename ... States >
+      static bool match( Input & in, Debug & de, States && ... st )
+      {
+	 typename Input::template marker< false > p( in );
+
+	 if ( Rule::template match< Must >( in, de, std::forward< States >( st ) ... ) ) {
+	    const size_t begin = in.offset( p.here() );
+	    apply_view_helper< Func, Funcs ... >::apply( match_view( begin, in.offset( in.here() ) - begin ), std::forward< States >( st ) ... );
+	    return p( true );
+	 }
+	 return p( false );
+      }
+   };
+
    template< typename Func >
    struct action_base
    {
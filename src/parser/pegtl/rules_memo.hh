@@ -0,0 +1,158 @@
+// Copyright (c) 2008 Dr. Colin Hirsch
+// Please see license.txt for license.
+
+#ifndef COHI_PEGTL_HH
+#error "Please #include only pegtl.hh (rather than individual pegtl_*.hh files)."
+#endif
+
+#ifndef COHI_PEGTL_RULES_MEMO_HH
+#define COHI_PEGTL_RULES_MEMO_HH
+
+
+namespace pegtl
+{
+   // Packrat-style memoisation, opt-in per rule: wrapping a rule in memo<>
+   // caches whether it matched at a given input position, and where the
+   // match ended. When a backtracking alternative tries the same rule at
+   // the same position again, the cached result is replayed instead of
+   // re-scanning the input.
+
+   // The cache lives in the input, which therefore has to be wrapped in
+   // memo_input<>. The table is direct-mapped with 2^Bits entries, so its
+   // size is bounded; a collision simply evicts the older result.
+
+   // Because a hit skips the wrapped rule entirely, actions inside it are
+   // not applied again. Only wrap rules that have no actions, or whose
+   // actions are applied by an enclosing ifapply, or whose effect on the
+   // states can be replayed by specialising memo_state<> below. What the
+   // replay needs is kept in each entry, as a Value.
+
+   template< typename Input, unsigned Bits = 10, typename Value = char >
+   class memo_input : public Input
+   {
+   public:
+      template< typename ... Args >
+      explicit
+      memo_input( Args && ... args )
+	    : Input( std::forward< Args >( args ) ... )
+      { }
+
+      typedef typename Input::iterator iterator;
+
+      struct memo_entry
+      {
+	 memo_entry()
+	       : rule( 0 ),
+		 offset( 0 ),
+		 success( false ),
+		 value()
+	 { }
+
+	 const void * rule;
+	 size_t offset;
+	 bool success;
+	 iterator end;
+	 Value value;
+      };
+
+      // Returns the entry for rule at offset, which the caller has to check
+      // for a match against rule and offset before using the cached result.
+
+      memo_entry & memo_slot( const void * rule, const size_t offset )
+      {
+	 if ( m_table.empty() ) {
+	    m_table.resize( size_t( 1 ) << Bits );
+	 }
+	 const size_t h = ( reinterpret_cast< uintptr_t >( rule ) >> 3 ) * 31 + offset;
+	 return m_table[ h & ( m_table.size() - 1 ) ];
+      }
+
+      // Forgets every cached result, for when the same input is matched
+      // again in a way that has to see every rule, such as when looking
+      // for where an error is.
+
+      void memo_clear()
+      {
+	 m_table.clear();
+      }
+
+   private:
+      std::vector< memo_entry > m_table;
+   };
+
+   // Saves what a successful match of Rule left in the states into a memo
+   // entry, and restores it when the match is replayed. By default there
+   // is nothing to save.
+
+   template< typename Rule >
+   struct memo_state
+   {
+      template< typename Entry, typename ... States >
+      static void save( Entry &, States && ... )
+      { }
+
+      template< typename Entry, typename ... States >
+      static void restore( const Entry &, States && ... )
+      { }
+   };
+
+   template< typename Rule >
+   struct memo_key
+   {
+      static const char id = 0;
+   };
+
+   template< typename Rule >
+   const char memo_key< Rule >::id;
+
+   template< typename Rule >
+   struct memo
+   {
+      typedef memo key_type;
+
+      template< typename Print >
+      static void prepare( Print & st )
+      {
+	 prepare1< memo, Rule >( st, "", "{ ", " ", " }", "" );
+      }
+
+      template< bool Must, typename Input, typename Debug, typename ... States >
+      static bool match( Input & in, Debug & de, States && ... st )
+      {
+	 const void * const rule = & memo_key< Rule >::id;
+	 const size_t offset = in.offset( in.here() );
+
+	 typename Input::memo_entry & e = in.memo_slot( rule, offset );
+
+	 if ( ( e.rule == rule ) && ( e.offset == offset ) ) {
+	    if ( e.success ) {
+	       in.jump( e.end );
+	       memo_state< Rule >::restore( e, std::forward< States >( st ) ... );
+	       return true;
+	    }
+	    // A failure which is required has to raise the error the rule
+	    // raises, so the rule is run again rather than replayed.
+	    if ( ! Must ) {
+	       return false;
+	    }
+	 }
+	 const bool success = de.template match< Must, Rule >( in, std::forward< States >( st ) ... );
+
+	 // The slot may have been reused by a nested memo<> in the meantime.
+	 typename Input::memo_entry & f = in.memo_slot( rule, offset );
+	 f.rule = rule;
+	 f.offset = offset;
+	 f.success = success;
+	 f.end = in.here();
+
+	 if ( success ) {
+	    memo_state< Rule >::save( f, std::forward< States >( st ) ... );
+	 }
+
+	 return success;
+      }
+   };
+
+} // pegtl
+
+#endif
@@ -320,6 +320,236 @@ namespace pegtl
       }
    };
 
+   // Character classes for scanning whole runs of characters at once.
+   // A class is built from class_range<> and class_set<> parts, each of
+   // which can test a single character or, where SSE2 or AVX2 is
+   // available, a whole vector of characters with a few compares. Only
+   // ASCII characters can be members; the vector compares are signed, so
+   // bytes with the high bit set never are.
+
+   template< int C, int D >
+   struct class_range
+   {
+      static_assert( ( C > 0 ) && ( C <= D ) && ( D < 127 ), "pegtl: class_range< C, D > must be within ASCII" );
+
+      static bool test( const int c )
+      {
+	 return ( c >= C ) && ( c <= D );
+      }
+
+#if defined( __SSE2__ )
+      static __m128i test( const __m128i v )
+      {
+	 return _mm_and_si128( _mm_cmpgt_epi8( v, _mm_set1_epi8( C - 1 ) ), _mm_cmplt_epi8( v, _mm_set1_epi8( D + 1 ) ) );
+      }
+#endif
+
+#if defined( __AVX2__ )
+      static __m256i test( const __m256i v )
+      {
+	 return _mm256_and_si256( _mm256_cmpgt_epi8( v, _mm256_set1_epi8( C - 1 ) ), _mm256_cmpgt_epi8( _mm256_set1_epi8( D + 1 ), v ) );
+      }
+#endif
+   };
+
+   template< int ... Chars > struct class_set;
+
+   template< int Char >
+   struct class_set< Char >
+   {
+      static bool test( const int c )
+      {
+	 return c == Char;
+      }
+
+#if defined( __SSE2__ )
+      static __m128i test( const __m128i v )
+      {
+	 return _mm_cmpeq_epi8( v, _mm_set1_epi8( Char ) );
+      }
+#endif
+
+#if defined( __AVX2__ )
+      static __m256i test( const __m256i v )
+      {
+	 return _mm256_cmpeq_epi8( v, _mm256_set1_epi8( Char ) );
+      }
+#endif
+   };
+
+   template< int Char, int Next, int ... Chars >
+   struct class_set< Char, Next, Chars ... >
+   {
+      static bool test( const int c )
+      {
+	 return ( c == Char ) || class_set< Next, Chars ... >::test( c );
+      }
+
+#if defined( __SSE2__ )
+      static __m128i test( const __m128i v )
+      {
+	 return _mm_or_si128( class_set< Char >::test( v ), class_set< Next, Chars ... >::test( v ) );
+      }
+#endif
+
+#if defined( __AVX2__ )
+      static __m256i test( const __m256i v )
+      {
+	 return _mm256_or_si256( class_set< Char >::test( v ), class_set< Next, Chars ... >::test( v ) );
+      }
+#endif
+   };
+
+   template< typename Part, typename ... Parts >
+   struct char_class
+   {
+      static bool test( const int c )
+      {
+	 return Part::test( c ) || char_class< Parts ... >::test( c );
+      }
+
+#if defined( __SSE2__ )
+      static __m128i test( const __m128i v )
+      {
+	 return _mm_or_si128( Part::test( v ), char_class< Parts ... >::test( v ) );
+      }
+#endif
+
+#if defined( __AVX2__ )
+      static __m256i test( const __m256i v )
+      {
+	 return _mm256_or_si256( Part::test( v ), char_class< Parts ... >::test( v ) );
+      }
+#endif
+   };
+
+   template< typename Part >
+   struct char_class< Part >
+	 : Part {};
+
+   // Returns the length of the run of Class characters at the start of
+   // [ begin, end ). Full vectors are tested at once; the tail, which is
+   // shorter than a vector, is tested one character at a time so that
+   // nothing past end is read.
+
+   template< typename Class >
+   inline size_t scan_class( const char * const begin, const char * const end )
+   {
+      const char * run = begin;
+
+#if defined( __AVX2__ )
+      while ( end - run >= 32 ) {
+	 const __m256i v = _mm256_loadu_si256( reinterpret_cast< const __m256i * >( run ) );
+	 const unsigned misses = ~unsigned( _mm256_movemask_epi8( Class::test( v ) ) );
+	 if ( misses ) {
+	    return ( run - begin ) + __builtin_ctz( misses );
+	 }
+	 run += 32;
+      }
+#endif
+
+#if defined( __SSE2__ )
+      while ( end - run >= 16 ) {
+	 const __m128i v = _mm_loadu_si128( reinterpret_cast< const __m128i * >( run ) );
+	 const unsigned misses = ~unsigned( _mm_movemask_epi8( Class::test( v ) ) ) & 0xffff;
+	 if ( misses ) {
+	    return ( run - begin ) + __builtin_ctz( misses );
+	 }
+	 run += 16;
+      }
+#endif
+
+      while ( ( run != end ) && Class::test( * run ) ) {
+	 ++run;
+      }
+      return run - begin;
+   }
+
+   // Inputs whose iterators are plain pointers underneath are scanned in
+   // place with scan_class(); all others one character at a time.
+
+   template< typename Input, typename = void >
+   struct contiguous_input
+	 : std::false_type {};
+
+   template< typename Input >
+   struct contiguous_input< Input, typename std::enable_if< std::is_pointer< typename std::decay< decltype( std::declval< const Input & >().here().base() ) >::type >::value >::type >
+	 : std::true_type {};
+
+   template< typename Class, typename Input >
+   inline size_t consume_class( Input & in, const std::true_type & )
+   {
+      const size_t n = scan_class< Class >( in.data(), in.data() + in.remaining() );
+      in.skip( n );
+      return n;
+   }
+
+   template< typename Class, typename Input >
+   inline size_t consume_class( Input & in, const std::false_type & )
+   {
+      size_t n = 0;
+
+      while ( ( ! in.eof() ) && Class::test( in.peek() ) ) {
+	 in.bump();
+	 ++n;
+      }
+      return n;
+   }
+
+   template< typename Class, typename Input >
+   inline size_t consume_class( Input & in )
+   {
+      return consume_class< Class >( in, contiguous_input< Input >() );
+   }
+
+   // Rules star_run< Class > and plus_run< Class > are equivalent to star<>
+   // and plus<> of a rule matching one character of Class, but consume
+   // the whole run in one step.
+
+   template< typename Class >
+   struct star_run
+   {
+      typedef star_run key_type;
+
+      template< typename Print >
+      static void prepare( Print & st )
+      {
+	 st.template update< star_run >( "*[" + demangle< Class >() + "]", true );
+      }
+
+      template< bool, typename Input, typename Debug, typename ... States >
+      static bool match( Input & in, Debug &, States && ... )
+      {
+	 consume_class< Class >( in );
+	 return true;
+      }
+   };
+
+   template< typename Class >
+   struct plus_run
+   {
+      typedef plus_run key_type;
+
+      template< typename Print >
+      static void prepare( Print & st )
+      {
+	 st.template update< plus_run >( "+[" + demangle< Class >() + "]", true );
+      }
+
+      template< bool, typename Input, typename Debug, typename ... States >
+      static bool match( Input & in, Debug &, States && ... )
+      {
+	 return consume_class< Class >( in ) != 0;
+      }
+   };
+
+   typedef char_class< class_range< '0', '9' > > digit_class;
+   typedef char_class< class_range< 'a', 'z' >, class_range< 'A', 'Z' > > alpha_class;
+   typedef char_class< class_range< 'a', 'z' >, class_range< 'A', 'Z' >, class_range< '0', '9' > > alnum_class;
+   typedef char_class< class_set< ' ', '\t' > > blank_class;
+   typedef char_class< class_range< 'a', 'z' >, class_range< 'A', 'Z' >, class_set< '_' > > ident1_class;
+   typedef char_class< class_range< 'a', 'z' >, class_range< 'A', 'Z' >, class_range< '0', '9' >, class_set< '_' > > ident2_class;
+
    typedef sor< one< '_' >, alpha > ident1;
    typedef sor< digit, ident1 > ident2;
 
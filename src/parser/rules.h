@@ -8,13 +8,46 @@
 #ifndef RULES_H_
 #define RULES_H_
 
+#include <cctype>
+
 #include "actions.h"
+#include "lexer.h"
 
 namespace amalgam {
 namespace parser {
 
 using namespace pegtl;
 
+// The grammar runs over the tokens made by lex() rather than over
+// characters, so blanks are never seen, and a token which has to be
+// matched again after backtracking costs a comparison, not a re-scan.
+
+/** Matches a token of a kind, and if successful, pushes a node for it on
+ * the expression stack. */
+template<token_kind Kind, node_type nt>
+   struct push_token {
+      typedef push_token key_type;
+
+      template<typename Print>
+         static void
+         prepare(Print &st) {
+            st.template update<push_token>(demangle<push_token>(), true);
+         }
+
+      template<bool Must, typename Input, typename Debug>
+         static bool
+         match(Input &in, Debug &, expression_builder &b, module_ptr_t m) {
+            if (in.eof() || in.kind() != Kind) {
+               return false;
+            }
+
+            b.operand(make_node(nt, in.start(), in.length(), in.symbol(), m));
+            in.bump();
+
+            return true;
+         }
+   };
+
 /** 
  * A literal integer is: + / - (0-9)+ (a-zA-Z)*
  *
@@ -22,51 +55,510 @@ using namespace pegtl;
  * Number
  * Specifier
  * 
+ * The lexer leaves the sign as an operator token, since only the parser
+ * knows whether an operand is expected. It belongs to the literal when it
+ * is right in front of the digits.
  */
-struct literal_integer : seq<opt<one<'+', '-'> >, plus<digit>, opt<plus<alpha> > > {
-};
+struct push_integer {
+   typedef push_integer key_type;
 
-/** Matches a literal_integer, and if successful, pushes it on the expression stack. Also
- * provides for space padding. */
-struct push_integer : pad<
-      ifapply<literal_integer, push_node<node_type::literal_int> >, space> {
-};
+   template<typename Print>
+      static void
+      prepare(Print &st) {
+         st.template update<push_integer>("push_integer", true);
+      }
+
+   template<bool Must, typename Input, typename Debug>
+      static bool
+      match(Input &in, Debug &, expression_builder &b, module_ptr_t m) {
+         if (in.eof()) {
+            return false;
+         }
+
+         if (in.kind() == token_kind::integer) {
+            b.operand(make_literal(in.start(), in.length(), in.symbol(), m));
+            in.bump();
+            return true;
+         }
+
+         if (in.kind() != token_kind::op || (in.symbol() != builtin_symbol::add && in.symbol() != builtin_symbol::sub)) {
+            return false;
+         }
+
+         typename Input::template marker<false> p(in);
+         auto start = in.start();
+
+         in.bump();
+         if (in.eof() || in.kind() != token_kind::integer || in.start() != start + 1) {
+            return p(false);
+         }
 
-struct identifier : seq< plus< sor<alpha, one<'_'> > >, star< sor<alnum, one<'_'> > >  > {
+         auto length = in.length() + 1;
+         auto sym = m->get_symbols()->intern(m->get_source()->at(start, length), length);
+
+         b.operand(make_literal(start, length, sym, m));
+         in.bump();
+
+         return p(true);
+      }
+
+   /** Makes a literal node, decoding its value. A literal which can not
+    * be decoded, such as one which does not fit in 64 bits, is a syntax
+    * error. */
+   static auto
+   make_literal(uint64_t start, std::size_t length, symbol_t sym, module_ptr_t m) -> ast_ptr_t {
+      auto n = make_node(node_type::literal_int, start, length, sym, m);
+
+      auto &text = m->get_symbols()->name(sym);
+      auto error = decode_int_literal(text.data(), text.size(), n->literal);
+      if (error) {
+         throw syntax_error(start, "integer literal '" + text + "' " + error);
+      }
+
+      return n;
+   }
 };
 
-/** Matches an identifier, and if successful, pushes it on the expression stack. Also
- * provides for space padding. */
-struct push_identifier : pad<
-      ifapply<identifier, push_node<node_type::identifier> >, space> {
+/** Matches an identifier, and if successful, pushes it on the expression stack. */
+struct push_identifier : push_token<token_kind::identifier, node_type::identifier> {
 };
 
 
 struct expr;
 
-struct push_group : pad<
-    seq<one<'('>, expr, one<')'> >, space> {};
+struct push_group : seq<ifapply_view<token<token_kind::open>, open_group>, expr,
+      ifapply_view<token<token_kind::close>, close_group> > {
+};
 
 /** An expression atom is one atomic unit of expression. This could be a single
  * literal, or a parenthetical expression. */
 struct expr_atom : sor<push_integer, push_identifier, push_group > {
 };
 
-struct literal_op : plus< one<'+', '-', '*', '/', '&', '|', '^', '=', '<', '>', 
-                         ':', ';', '[', ']', '{', '}', ',', '.', '?', '\\', 
-                         '~', '!', '@', '#', '$', '%' > > {
+/** The input the parser runs over: a token_input, with a table for the
+ * rules wrapped in memo<>, which keeps the tree each match built. */
+typedef memo_input<token_input, 10, ast_ptr_t> parser_input;
+
+} // end parser namespace
+} // end amalgam namespace
+
+namespace pegtl {
+
+/** A match of an expression atom leaves one operand on the builder, the
+ * tree of the atom, so a memoized match is replayed by adding that tree
+ * again. Statement forms are tried in order, and each parses its operands
+ * again, so this keeps from building the same trees over. */
+template<>
+   struct memo_state<amalgam::parser::expr_atom> {
+      template<typename Entry>
+         static void
+         save(Entry &e, amalgam::parser::expression_builder &b, amalgam::parser::module_ptr_t) {
+            e.value = b.last_operand();
+         }
+
+      template<typename Entry>
+         static void
+         restore(const Entry &e, amalgam::parser::expression_builder &b, amalgam::parser::module_ptr_t) {
+            b.operand(e.value);
+         }
+   };
+
+} // end pegtl namespace
+
+namespace amalgam {
+namespace parser {
+
+//=====----------------------------------------------------------------------======//
+//      Syntax Forms
+//=====----------------------------------------------------------------------======//
+
+// The forms declared in lib/syntax are not compiled into grammar rules.
+// Instead the rules below read one token, look it up in the syntax table,
+// and then match the elements of the forms it leads, so the cost of
+// parsing does not grow with the number of forms.
+
+/** Matches a keyword or operator token. Returns the token's symbol and
+ * sets v to the token, or returns no_symbol if there is no token here. */
+template<typename Input>
+   auto
+   match_syntax_token(Input &in, match_view &v) -> symbol_t {
+      if (in.eof() || (in.kind() != token_kind::identifier && in.kind() != token_kind::op)) {
+         return no_symbol;
+      }
+
+      v.offset = in.start();
+      v.length = in.length();
+
+      auto sym = in.symbol();
+      in.bump();
+
+      return sym;
+   }
+
+/** Matches an expression as a tree of its own, without attaching it to
+ * anything. Returns nullptr if there is no expression here. */
+template<typename Input, typename Debug>
+   auto
+   match_syntax_hole(Input &in, Debug &de, expression_builder &b, module_ptr_t m) -> ast_ptr_t {
+      auto mark = b.get_mark();
+
+      b.open_group();
+      if (!de.template match<false, expr>(in, b, m)) {
+         b.rewind(mark);
+         return nullptr;
+      }
+
+      return b.finish_group();
+   }
+
+/** Matches elements [first, last) of a form, adding the operands and
+ * blocks to n. On failure the input and the builder are left wherever
+ * the match stopped, so the caller has to rewind them. */
+template<typename Input, typename Debug>
+   auto
+   match_syntax_elements(const syntax_element_list_t &elements, std::size_t first, std::size_t last,
+                         Input &in, Debug &de, expression_builder &b, module_ptr_t m, ast_ptr_t n) -> bool {
+      match_view v(0, 0);
+
+      for (auto i = first; i < last; ++i) {
+         auto &e = elements[i];
+
+         switch (e.type) {
+            case syntax_element_type::token:
+               if (match_syntax_token(in, v) != e.token) {
+                  return false;
+               }
+               break;
+
+            case syntax_element_type::hole: {
+               auto c = match_syntax_hole(in, de, b, m);
+               if (!c) {
+                  return false;
+               }
+
+               n->children.push_back(c);
+               break;
+            }
+
+            case syntax_element_type::block: {
+               // Blocks hold the rest of the line after the colon, if any.
+               auto colon = match_syntax_token(in, v);
+               if (colon == no_symbol || colon != m->get_symbols()->intern(":", 1)) {
+                  return false;
+               }
+
+               auto block = make_node(node_type::group, v.offset, v.length, colon, m);
+               if (auto body = match_syntax_hole(in, de, b, m)) {
+                  block->children.push_back(body);
+               }
+
+               n->children.push_back(block);
+               break;
+            }
+
+            case syntax_element_type::repeat:
+               while (true) {
+                  typename Input::template marker<false> p(in);
+                  auto mark = b.get_mark();
+                  auto count = n->children.size();
+
+                  if (!match_syntax_elements(e.elements, 0, e.elements.size(), in, de, b, m, n)) {
+                     b.rewind(mark);
+                     n->children.resize(count);
+                     p(false);
+                     break;
+                  }
+
+                  p(true);
+               }
+               break;
+         } // end switch
+      }
+
+      return true;
+   }
+
+/**
+ * Matches the operator between two operands. Builtin operators are found
+ * in the operator table, and operators declared in lib/syntax by their
+ * token, which may be a word such as 'and'. Forms with operands in the
+ * middle, such as () if () else (), have those matched here, so the
+ * builder only ever sees binary operators.
+ */
+struct push_op {
+   typedef push_op key_type;
+
+   template<typename Print>
+      static void
+      prepare(Print &st) {
+         st.template insert<expr>();
+         st.template update<push_op>("push_op", true);
+      }
+
+   template<bool Must, typename Input, typename Debug>
+      static bool
+      match(Input &in, Debug &de, expression_builder &b, module_ptr_t m) {
+         typename Input::template marker<false> p(in);
+
+         match_view v(0, 0);
+         auto sym = match_syntax_token(in, v);
+         if (sym == no_symbol) {
+            return p(false);
+         }
+
+         auto &syntax = b.get_syntax();
+         auto form = syntax.find_infix(sym);
+
+         if (!form && !b.get_operators().is_operator(sym)) {
+            // Words, and tokens which some form expects, end the expression
+            // instead.
+            auto &name = m->get_symbols()->name(sym);
+            if (syntax.is_token(sym) || std::isalpha((unsigned char) name[0]) || name[0] == '_') {
+               return p(false);
+            }
+
+            throw syntax_error(v.offset, "unknown operator '" + name + "'");
+         }
+
+         auto n = make_node(node_type::op, v.offset, v.length, sym, m);
+
+         if (form) {
+            auto mark = b.get_mark();
+            if (!match_syntax_elements(form->elements, 2, form->elements.size() - 1, in, de, b, m, n)) {
+               b.rewind(mark);
+               return p(false);
+            }
+         }
+
+         b.binary_operator(n);
+         return p(true);
+      }
+};
+
+struct expr : list<memo<expr_atom>, push_op> {
+};
+
+/**
+ * Matches a whole line as one of the statement forms led by its first
+ * keyword. The forms are tried in the order they were declared, so longer
+ * forms have to be declared before the forms they extend.
+ */
+struct syntax_statement {
+   typedef syntax_statement key_type;
+
+   template<typename Print>
+      static void
+      prepare(Print &st) {
+         st.template insert<expr, end_of_line>();
+         st.template update<syntax_statement>("syntax_statement", true);
+      }
+
+   template<bool Must, typename Input, typename Debug>
+      static bool
+      match(Input &in, Debug &de, expression_builder &b, module_ptr_t m) {
+         typename Input::template marker<false> p(in);
+
+         match_view v(0, 0);
+         auto keyword = match_syntax_token(in, v);
+         auto forms = b.get_syntax().find_statements(keyword);
+         if (!forms) {
+            return p(false);
+         }
+
+         for (auto index : *forms) {
+            auto &f = b.get_syntax().get_form(index);
+
+            typename Input::template marker<false> q(in);
+            auto mark = b.get_mark();
+            auto n = make_node(node_type::statement, v.offset, v.length, keyword, m);
+
+            if (match_syntax_elements(f.elements, 1, f.elements.size(), in, de, b, m, n)
+                && de.template match<false, end_of_line>(in, b, m)) {
+               b.operand(n);
+               q(true);
+               return p(true);
+            }
+
+            b.rewind(mark);
+         }
+
+         return p(false);
+      }
+};
+
+/**
+ * Matches from module import name, name... on a line of its own. The
+ * module may be a dotted path. Imports are not expressions, so they are
+ * recorded on the module rather than built into a tree; the parser
+ * resolves them before verifying the module.
+ */
+struct import_statement {
+   typedef import_statement key_type;
+
+   template<typename Print>
+      static void
+      prepare(Print &st) {
+         st.template insert<end_of_line>();
+         st.template update<import_statement>("import_statement", true);
+      }
+
+   /** Matches an identifier, and returns its text, or an empty string if
+    * there is none. Keywords are only recognized by their text, so that
+    * they can still be used as names elsewhere. */
+   template<typename Input>
+      static auto
+      name(Input &in, module_ptr_t m) -> string {
+         if (in.eof() || in.kind() != token_kind::identifier) {
+            return string();
+         }
+
+         auto &n = m->get_symbols()->name(in.symbol());
+         in.bump();
+
+         return n;
+      }
+
+   /** Matches an operator token spelled s. */
+   template<typename Input>
+      static auto
+      punctuation(Input &in, module_ptr_t m, const char *s) -> bool {
+         if (in.eof() || in.kind() != token_kind::op || m->get_symbols()->name(in.symbol()) != s) {
+            return false;
+         }
+
+         in.bump();
+         return true;
+      }
+
+   template<bool Must, typename Input, typename Debug>
+      static bool
+      match(Input &in, Debug &de, expression_builder &b, module_ptr_t m) {
+         typename Input::template marker<false> p(in);
+
+         module_import i;
+         i.offset = in.offset(in.here());
+
+         if (name(in, m) != "from") {
+            return p(false);
+         }
+
+         i.module = name(in, m);
+         if (i.module.empty()) {
+            return p(false);
+         }
+
+         while (punctuation(in, m, ".")) {
+            auto part = name(in, m);
+            if (part.empty()) {
+               return p(false);
+            }
+
+            i.module += "." + part;
+         }
+
+         if (name(in, m) != "import") {
+            return p(false);
+         }
+
+         do {
+            i.names.push_back(name(in, m));
+            if (i.names.back().empty()) {
+               return p(false);
+            }
+         } while (punctuation(in, m, ","));
+
+         if (!de.template match<false, end_of_line>(in, b, m)) {
+            return p(false);
+         }
+
+         m->add_import(i);
+         return p(true);
+      }
+};
+
+struct expr_list : ifapply_view<until<end_of_line, expr>, finish_expression> {
 };
 
-struct push_op : pad<ifapply<literal_op, push_node<node_type::op> >, space> {
+struct statement : sor<import_statement, ifapply_view<syntax_statement, finish_expression>, expr_list> {
 };
 
-struct expr : list<expr_atom, push_op> {
+struct grammar : until<eof, statement> {
 };
 
-struct expr_list : ifapply<until<eol, expr>, sweep_expression_tree> {
+//=====----------------------------------------------------------------------======//
+//      Error Recovery
+//=====----------------------------------------------------------------------======//
+
+/** Records a diagnostic for the statement at the current position, which
+ * failed to parse. The statement is parsed again, noting the furthest
+ * position any rule got to, since that is where the error is. Leaves the
+ * input where it was. */
+template<typename Input>
+   void
+   locate_syntax_error(Input &in, expression_builder &b, module_ptr_t m) {
+      typename Input::template marker<false> p(in);
+      auto mark = b.get_mark();
+
+      // Every rule has to be tried again to see how far it gets, rather
+      // than have memo<> replay it.
+      in.memo_clear();
+
+      furthest_debug fd(in.offset(in.here()));
+
+      try {
+         fd.template match<false, statement>(in, b, m);
+      } catch (const syntax_error &e) {
+         b.rewind(mark);
+         m->add_diagnostic(e.offset, e.what());
+         return;
+      } catch (const parse_error &) {
+      }
+
+      b.rewind(mark);
+      m->add_diagnostic(fd.furthest(), "syntax error");
+   }
+
+/**
+ * Matches a statement. If the statement has a syntax error, a diagnostic
+ * is added to the module and the rest of the line is skipped, so that
+ * parsing resumes with the next statement instead of stopping. Whatever
+ * was built for the broken statement is thrown away.
+ */
+struct recover_statement {
+   typedef recover_statement key_type;
+
+   template<typename Print>
+      static void
+      prepare(Print &st) {
+         st.template insert<statement, end_of_line>();
+         st.template update<recover_statement>("recover_statement", true);
+      }
+
+   template<bool Must, typename Input, typename Debug>
+      static bool
+      match(Input &in, Debug &de, expression_builder &b, module_ptr_t m) {
+         auto mark = b.get_mark();
+
+         {
+            typename Input::template marker<false> p(in);
+
+            try {
+               if (de.template match<false, statement>(in, b, m)) {
+                  return p(true);
+               }
+            } catch (const parse_error &) {
+               // Reported by locate_syntax_error() below.
+            }
+         }
+
+         b.rewind(mark);
+         locate_syntax_error(in, b, m);
+
+         return de.template match<false, until<end_of_line> >(in, b, m);
+      }
 };
 
-struct grammar : expr_list {
+struct recovering_grammar : until<eof, recover_statement> {
 };
 
 } // end parser namespace
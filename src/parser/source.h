@@ -0,0 +1,157 @@
+/*
+ * source.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SOURCE_H_
+#define SOURCE_H_
+
+#include <memory>
+
+#include "pegtl.hh"
+#include "types.h"
+
+namespace amalgam {
+namespace parser {
+
+/**
+ * Holds the text a module was parsed from. AST nodes record where they
+ * start and end in the source instead of keeping copies of their text,
+ * so the source lives as long as the module does.
+ */
+class source {
+public:
+   virtual ~source() {
+   }
+
+   /** Gets the text starting at offset. The next length characters are
+    * guaranteed to be contiguous in memory. */
+   virtual auto
+   at(uint64_t offset, std::size_t length) const -> const char * = 0;
+
+   /** Copies out the text between two positions. Meant for diagnostics,
+    * not for the parsing fast path. */
+   auto
+   text(uint64_t start_pos, uint64_t end_pos) const -> string {
+      auto length = std::size_t(end_pos - start_pos);
+      auto s = at(start_pos, length);
+
+      return string(s, s + length);
+   }
+};
+
+/** The type for shared pointers to sources. */
+typedef std::shared_ptr<source> source_ptr_t;
+
+/** A source which is entirely in memory at once. */
+class memory_source : public source {
+public:
+   /** The first character of the source text. */
+   virtual auto
+   data() const -> const char * = 0;
+
+   /** The length of the source text in characters. */
+   virtual auto
+   size() const -> std::size_t = 0;
+
+   /** Where data() starts in the input the text was taken from. */
+   virtual auto
+   base() const -> uint64_t {
+      return 0;
+   }
+
+   /** The number of the line data() starts on. */
+   virtual auto
+   first_line() const -> std::size_t {
+      return 1;
+   }
+
+   auto
+   at(uint64_t offset, std::size_t) const -> const char * {
+      return data() + (offset - base());
+   }
+};
+
+/** The type for shared pointers to memory sources. */
+typedef std::shared_ptr<memory_source> memory_source_ptr_t;
+
+/** A source held in memory as a string. */
+class string_source : public memory_source {
+   string contents;
+
+public:
+   string_source(const string &_contents) :
+            contents(_contents) {
+   }
+
+   auto
+   data() const -> const char * {
+      return contents.data();
+   }
+
+   auto
+   size() const -> std::size_t {
+      return contents.size();
+   }
+};
+
+/** A source mapped into memory straight from a file. The pages are shared
+ * with the page cache, so the file is never copied. */
+class mapped_source : public memory_source {
+   pegtl::file_mapper mapper;
+
+public:
+   mapped_source(const string &path) :
+            mapper(path) {
+   }
+
+   auto
+   data() const -> const char * {
+      return mapper.data();
+   }
+
+   auto
+   size() const -> std::size_t {
+      return mapper.size();
+   }
+};
+
+/** A source which holds one line of a longer input, such as a pipe,
+ * which is never in memory all at once. Offsets still count from the
+ * start of the whole input. */
+class line_source : public memory_source {
+   string line;
+   uint64_t offset;
+   std::size_t number;
+
+public:
+   line_source(const string &_line, uint64_t _offset, std::size_t _number) :
+            line(_line), offset(_offset), number(_number) {
+   }
+
+   auto
+   data() const -> const char * {
+      return line.data();
+   }
+
+   auto
+   size() const -> std::size_t {
+      return line.size();
+   }
+
+   auto
+   base() const -> uint64_t {
+      return offset;
+   }
+
+   auto
+   first_line() const -> std::size_t {
+      return number;
+   }
+};
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* SOURCE_H_ */
@@ -0,0 +1,130 @@
+/*
+ * symbol_map.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SYMBOL_MAP_H_
+#define SYMBOL_MAP_H_
+
+#include <utility>
+#include <vector>
+
+#include "symbols.h"
+
+namespace amalgam {
+namespace parser {
+
+/**
+ * Maps interned names to values with an open-addressing hash table.
+ *
+ * The entries are kept in one array, in the order they were added, and the
+ * table only holds their positions in it. A lookup probes the table and
+ * then reads one entry, and iterating walks the array, so the order is
+ * the same from one run to the next. Looking up a name which is not there
+ * never adds it.
+ */
+template<typename T>
+   class symbol_map {
+   public:
+      typedef std::pair<symbol_t, T> value_type;
+      typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+   private:
+      std::vector<value_type> entries;
+
+      /** The position of an entry plus one, or zero for an empty slot. The
+       * number of slots is always a power of two. */
+      std::vector<uint32_t> slots;
+
+      /** Finds the slot which holds sym, or the empty slot where it would
+       * go. There must be at least one slot. */
+      auto
+      slot_of(symbol_t sym) const -> std::size_t {
+         auto mask = slots.size() - 1;
+
+         // Symbols are numbered densely, and multiplying by an odd number
+         // keeps consecutive ones in distinct slots while spreading them.
+         for (std::size_t i = (sym * 2654435769u) & mask;; i = (i + 1) & mask) {
+            if (slots[i] == 0 || entries[slots[i] - 1].first == sym) {
+               return i;
+            }
+         }
+      }
+
+      /** Doubles the table, keeping it at most half full. */
+      void
+      grow() {
+         slots.assign(slots.empty() ? 16 : slots.size() * 2, 0);
+
+         for (std::size_t e = 0; e < entries.size(); ++e) {
+            slots[slot_of(entries[e].first)] = uint32_t(e + 1);
+         }
+      }
+
+   public:
+      /** Gets the value of sym, or nullptr if it has none. */
+      auto
+      find(symbol_t sym) const -> const T * {
+         if (slots.empty() || sym == no_symbol) {
+            return nullptr;
+         }
+
+         auto s = slots[slot_of(sym)];
+         return s ? &entries[s - 1].second : nullptr;
+      }
+
+      auto
+      find(symbol_t sym) -> T * {
+         return const_cast<T *>(static_cast<const symbol_map &>(*this).find(sym));
+      }
+
+      auto
+      contains(symbol_t sym) const -> bool {
+         return find(sym) != nullptr;
+      }
+
+      /** Sets the value of sym, adding it if it is not there yet. */
+      auto
+      set(symbol_t sym, const T &value) -> T & {
+         auto existing = find(sym);
+         if (existing) {
+            return *existing = value;
+         }
+
+         if ((entries.size() + 1) * 2 > slots.size()) {
+            grow();
+         }
+
+         slots[slot_of(sym)] = uint32_t(entries.size() + 1);
+         entries.push_back(value_type(sym, value));
+
+         return entries.back().second;
+      }
+
+      auto
+      size() const -> std::size_t {
+         return entries.size();
+      }
+
+      auto
+      empty() const -> bool {
+         return entries.empty();
+      }
+
+      /** Iterates over the entries in the order they were added. */
+      auto
+      begin() const -> const_iterator {
+         return entries.begin();
+      }
+
+      auto
+      end() const -> const_iterator {
+         return entries.end();
+      }
+   };
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* SYMBOL_MAP_H_ */
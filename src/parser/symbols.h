@@ -0,0 +1,219 @@
+/*
+ * symbols.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SYMBOLS_H_
+#define SYMBOLS_H_
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "types.h"
+
+namespace amalgam {
+namespace parser {
+
+/** The type for interned strings. Symbols from the same table compare
+ * equal exactly when their strings do. */
+typedef uint32_t symbol_t;
+
+/** The symbol returned by lookups for strings which were never interned. */
+const symbol_t no_symbol = ~symbol_t(0);
+
+/** Symbols which every table interns up front. Their IDs are the same in
+ * every module, so the verifier and generator can test for them directly. */
+struct builtin_symbol {
+   enum : symbol_t {
+      add,
+      sub,
+      mul,
+      div,
+      rem,
+      bit_and,
+      bit_or,
+      bit_xor,
+      shl,
+      shr,
+      ge,
+      le,
+      eq,
+      ne,
+      lt,
+      gt,
+      init,
+
+      /** The name of the method every module has, which holds the
+       * statements at module scope. */
+      default_method,
+
+      count
+   };
+};
+
+/** Determines if op is a builtin arithmetic or bitwise operator, whose
+ * operands and result all have the same type. */
+inline auto
+is_arithmetic(symbol_t op) -> bool {
+   switch (op) {
+      case builtin_symbol::add:
+      case builtin_symbol::sub:
+      case builtin_symbol::mul:
+      case builtin_symbol::div:
+      case builtin_symbol::rem:
+      case builtin_symbol::bit_and:
+      case builtin_symbol::bit_or:
+      case builtin_symbol::bit_xor:
+      case builtin_symbol::shl:
+      case builtin_symbol::shr:
+         return true;
+
+      default:
+         return false;
+   }
+}
+
+/** Determines if op is a builtin comparison, whose operands have the
+ * same type. */
+inline auto
+is_comparison(symbol_t op) -> bool {
+   switch (op) {
+      case builtin_symbol::ge:
+      case builtin_symbol::le:
+      case builtin_symbol::eq:
+      case builtin_symbol::ne:
+      case builtin_symbol::lt:
+      case builtin_symbol::gt:
+         return true;
+
+      default:
+         return false;
+   }
+}
+
+/**
+ * Interns identifiers, literals and operators for a module. Each distinct
+ * string is stored once, and is afterwards referred to by a small integer.
+ *
+ * Strings can be interned straight out of the source buffer. A copy is
+ * only made the first time a string is seen.
+ */
+class symbol_table {
+   /** Maps symbols back to their strings. */
+   std::vector<string> names;
+
+   /** An open-addressed hash index over names. Empty slots hold
+    * no_symbol. The size is always a power of two. */
+   std::vector<symbol_t> slots;
+
+   static auto
+   hash(const char *s, std::size_t length) -> std::size_t {
+      // FNV-1a
+      std::size_t h = 2166136261u;
+      for (std::size_t i = 0; i < length; ++i) {
+         h = (h ^ (unsigned char) s[i]) * 16777619u;
+      }
+
+      return h;
+   }
+
+   /** Finds the slot which holds the string, or the empty slot where it
+    * would be inserted. */
+   auto
+   find_slot(const char *s, std::size_t length) const -> std::size_t {
+      auto mask = slots.size() - 1;
+      auto i = hash(s, length) & mask;
+
+      while (slots[i] != no_symbol) {
+         const string &n = names[slots[i]];
+         if (n.size() == length && std::memcmp(n.data(), s, length) == 0) {
+            break;
+         }
+
+         i = (i + 1) & mask;
+      }
+
+      return i;
+   }
+
+   void
+   grow() {
+      std::vector<symbol_t> old(slots.size() * 2, no_symbol);
+      slots.swap(old);
+
+      for (symbol_t sym = 0; sym < names.size(); ++sym) {
+         slots[find_slot(names[sym].data(), names[sym].size())] = sym;
+      }
+   }
+
+public:
+   symbol_table() :
+            slots(64, no_symbol) {
+      static const char *builtins[] = {
+         "+", "-", "*", "/", "%", "&", "|", "^", "<<", ">>",
+         ">=", "<=", "==", "!=", "<", ">", ":=", "__default__"
+      };
+
+      static_assert(sizeof(builtins) / sizeof(builtins[0]) == builtin_symbol::count,
+                    "every builtin symbol needs a spelling");
+
+      for (auto b : builtins) {
+         intern(b);
+      }
+   }
+
+   /** Gets the symbol for the string, adding it to the table if this is
+    * the first time it has been seen. */
+   auto
+   intern(const char *s, std::size_t length) -> symbol_t {
+      auto slot = find_slot(s, length);
+      if (slots[slot] != no_symbol) {
+         return slots[slot];
+      }
+
+      auto sym = symbol_t(names.size());
+      names.push_back(string(s, length));
+      slots[slot] = sym;
+
+      // Keep the load factor at or below one half.
+      if (names.size() * 2 > slots.size()) {
+         grow();
+      }
+
+      return sym;
+   }
+
+   auto
+   intern(const string &s) -> symbol_t {
+      return intern(s.data(), s.size());
+   }
+
+   /** Gets the symbol for the string without adding it. Returns
+    * no_symbol if the string was never interned. */
+   auto
+   lookup(const string &s) const -> symbol_t {
+      return slots[find_slot(s.data(), s.size())];
+   }
+
+   /** Gets the string a symbol was interned from. */
+   auto
+   name(symbol_t sym) const -> const string & {
+      return names[sym];
+   }
+
+   /** The number of distinct strings in the table. */
+   auto
+   size() const -> std::size_t {
+      return names.size();
+   }
+};
+
+/** The type for shared pointers to symbol tables. */
+typedef std::shared_ptr<symbol_table> symbol_table_ptr_t;
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* SYMBOLS_H_ */
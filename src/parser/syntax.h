@@ -0,0 +1,724 @@
+/*
+ * syntax.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SYNTAX_H_
+#define SYNTAX_H_
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <dirent.h>
+
+#include "pegtl.hh"
+#include "operators.h"
+#include "symbols.h"
+
+namespace amalgam {
+namespace parser {
+
+/** The kinds of element a syntax form is made of. */
+enum class syntax_element_type : uint8_t {
+   /** A keyword or operator which appears literally. */
+   token,
+
+   /** An expression, written (). */
+   hole,
+
+   /** A block, written (:). */
+   block,
+
+   /** Elements which may appear any number of times, written {...}*. */
+   repeat
+};
+
+struct syntax_element;
+
+/** The type for lists of syntax elements. */
+typedef std::vector<syntax_element> syntax_element_list_t;
+
+/** One element of a syntax form. */
+struct syntax_element {
+   syntax_element_type type;
+
+   /** The token to match, for token elements. */
+   symbol_t token;
+
+   /** The elements to repeat, for repeat elements. */
+   syntax_element_list_t elements;
+};
+
+/** Where a syntax form may appear. */
+enum class syntax_form_type : uint8_t {
+   expr,
+   statement
+};
+
+/** A syntax declaration, such as: statement <- while () (:) */
+struct syntax_form {
+   syntax_form_type type;
+   syntax_element_list_t elements;
+
+   /** The precedence an expression form declares for its operator, as
+    * in: expr 4 <- () and (), or zero if it declares none. */
+   int precedence;
+};
+
+class syntax_table;
+
+/** The type for shared pointers to syntax tables. */
+typedef std::shared_ptr<syntax_table> syntax_table_ptr_t;
+
+/** The state used while compiling syntax declarations. */
+struct syntax_compiler {
+   syntax_table &table;
+
+   /** The text being compiled. */
+   const char *text;
+
+   /** The form being declared. */
+   syntax_form form;
+
+   /** The element lists being filled in. Repeats push a new list. */
+   std::vector<syntax_element_list_t> lists;
+};
+
+/**
+ * Holds the expression and statement forms declared in lib/syntax, and
+ * the tables the parser dispatches on to find them. Statements are found
+ * by their leading keyword and expression forms by the token which
+ * follows their first operand, so adding a form never makes parsing the
+ * others slower.
+ *
+ * The table also holds the symbols every module starts out with. Each
+ * keyword and operator a form uses is interned up front, so its symbol
+ * is the same in every module parsed with the table.
+ */
+class syntax_table {
+   /** The symbols every module starts out with. */
+   symbol_table symbols;
+
+   /** The binary operators, including those declared as forms. */
+   operator_table operators;
+
+   /** Every form, in the order they were declared. */
+   std::vector<syntax_form> forms;
+
+   /** Statement forms by leading keyword, in the order they were
+    * declared. */
+   std::unordered_map<symbol_t, std::vector<uint32_t> > statements;
+
+   /** Expression forms by the token which follows their first operand. */
+   std::unordered_map<symbol_t, uint32_t> infix;
+
+   /** Indexed by symbol, indicates which symbols are used as tokens by
+    * some form. */
+   std::vector<bool> tokens;
+
+   /** Identifies the declarations the table was compiled from. */
+   uint64_t fingerprint;
+
+   /** Bumped whenever the cache layout changes. */
+   static const uint32_t cache_version = 1;
+
+   void
+   add_token(symbol_t sym) {
+      if (sym >= tokens.size()) {
+         tokens.resize(sym + 1, false);
+      }
+
+      tokens[sym] = true;
+   }
+
+   void
+   add_tokens(const syntax_element_list_t &elements) {
+      for (auto &e : elements) {
+         switch (e.type) {
+            case syntax_element_type::token:
+               add_token(e.token);
+               break;
+
+            case syntax_element_type::block:
+               add_token(symbols.intern(":"));
+               break;
+
+            case syntax_element_type::repeat:
+               add_tokens(e.elements);
+               break;
+
+            default:
+               break;
+         }
+      }
+   }
+
+   //=====----------------------------------------------------------------------======//
+   //      Cache Reading and Writing
+   //=====----------------------------------------------------------------------======//
+
+   template<typename T>
+      static void
+      write(std::ostream &out, T value) {
+         out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+      }
+
+   template<typename T>
+      static auto
+      read(std::istream &in, T &value) -> bool {
+         return bool(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+      }
+
+   static void
+   write_elements(std::ostream &out, const syntax_element_list_t &elements) {
+      write(out, uint32_t(elements.size()));
+
+      for (auto &e : elements) {
+         write(out, uint8_t(e.type));
+         write(out, e.token);
+         if (e.type == syntax_element_type::repeat) {
+            write_elements(out, e.elements);
+         }
+      }
+   }
+
+   static auto
+   read_elements(std::istream &in, syntax_element_list_t &elements) -> bool {
+      uint32_t count;
+      if (!read(in, count)) {
+         return false;
+      }
+
+      elements.resize(count);
+      for (auto &e : elements) {
+         uint8_t type;
+         if (!read(in, type) || !read(in, e.token)) {
+            return false;
+         }
+
+         e.type = syntax_element_type(type);
+         if (e.type == syntax_element_type::repeat && !read_elements(in, e.elements)) {
+            return false;
+         }
+      }
+
+      return true;
+   }
+
+public:
+   /** The precedence given to operators which are only known from their
+    * syntax declaration, when it does not declare one. They bind more
+    * loosely than every builtin operator except assignment. */
+   static const int declared_precedence = 2;
+
+   /** The highest precedence a declaration may give, so that declared
+    * operators never bind more tightly than the builtin ones. */
+   static const int max_declared_precedence = 4;
+
+   syntax_table() :
+            fingerprint(hash_bytes(nullptr, 0)) {
+   }
+
+   /** Adds a form to the table. Statement forms must start with a keyword.
+    * Expression forms must start and end with an operand, with a token
+    * in between. */
+   void
+   add_form(const syntax_form &f) {
+      auto index = uint32_t(forms.size());
+      auto &e = f.elements;
+
+      if (f.type == syntax_form_type::statement) {
+         if (e.empty() || e.front().type != syntax_element_type::token) {
+            throw pegtl::parse_error("statement forms must start with a keyword");
+         }
+
+         if (f.precedence != 0) {
+            throw pegtl::parse_error("statement forms have no precedence");
+         }
+
+         statements[e.front().token].push_back(index);
+      } else {
+         if (e.size() < 3 || e.front().type != syntax_element_type::hole
+             || e[1].type != syntax_element_type::token || e.back().type != syntax_element_type::hole) {
+            throw pegtl::parse_error("expression forms must have the shape () op ... ()");
+         }
+
+         for (auto &i : e) {
+            if (i.type != syntax_element_type::token && i.type != syntax_element_type::hole) {
+               throw pegtl::parse_error("expression forms may only contain tokens and ()");
+            }
+         }
+
+         auto op = e[1].token;
+         if (infix.find(op) != infix.end()) {
+            throw pegtl::parse_error("operator '" + symbols.name(op) + "' is declared more than once");
+         }
+
+         infix[op] = index;
+
+         if (f.precedence != 0 && operators.is_operator(op)) {
+            throw pegtl::parse_error("operator '" + symbols.name(op) + "' is builtin, so its precedence is fixed");
+         }
+
+         if (f.precedence > max_declared_precedence) {
+            throw pegtl::parse_error("the precedence of operator '" + symbols.name(op) + "' must be from 1 to "
+                                     + std::to_string(max_declared_precedence));
+         }
+
+         // Forms with operands in the middle, like () if () else (), group
+         // to the right so that they can be chained.
+         if (!operators.is_operator(op)) {
+            operators.add(op, f.precedence != 0 ? f.precedence : declared_precedence,
+                          e.size() == 3 ? associativity::left : associativity::right);
+         }
+      }
+
+      add_tokens(e);
+      forms.push_back(f);
+   }
+
+   /** Compiles the syntax declarations in text. The name is only used for
+    * error messages. */
+   void
+   compile(const string &text, const string &name = "<syntax>");
+
+   /** Gets a fresh symbol table for a module, which already holds every
+    * symbol the forms use. */
+   auto
+   make_symbols() const -> symbol_table_ptr_t {
+      return symbol_table_ptr_t(new symbol_table(symbols));
+   }
+
+   /** Gets the symbols the forms use. */
+   auto
+   get_symbols() -> symbol_table & {
+      return symbols;
+   }
+
+   /** Gets a hash of the declarations the table was compiled from. Files
+    * parsed with tables which have different fingerprints may parse
+    * differently. */
+   auto
+   get_fingerprint() const -> uint64_t {
+      return fingerprint;
+   }
+
+   /** Gets the binary operators. */
+   auto
+   get_operators() const -> const operator_table & {
+      return operators;
+   }
+
+   /** Gets a form by index. */
+   auto
+   get_form(uint32_t index) const -> const syntax_form & {
+      return forms[index];
+   }
+
+   /** The number of forms in the table. */
+   auto
+   get_form_count() const -> std::size_t {
+      return forms.size();
+   }
+
+   /** Gets the indexes of the statement forms which start with keyword,
+    * or nullptr if there are none. */
+   auto
+   find_statements(symbol_t keyword) const -> const std::vector<uint32_t> * {
+      auto it = statements.find(keyword);
+      return it == statements.end() ? nullptr : &it->second;
+   }
+
+   /** Gets the expression form whose first operand is followed by op, or
+    * nullptr if there is none. */
+   auto
+   find_infix(symbol_t op) const -> const syntax_form * {
+      auto it = infix.find(op);
+      return it == infix.end() ? nullptr : &forms[it->second];
+   }
+
+   /** Indicates if some form uses the symbol as a token. */
+   auto
+   is_token(symbol_t sym) const -> bool {
+      return sym < tokens.size() && tokens[sym];
+   }
+
+   /** Writes the compiled table to path. The hash identifies the
+    * declarations the table was compiled from. */
+   auto
+   save(const string &path, uint64_t hash) const -> bool {
+      std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+
+      out.write("AMSX", 4);
+      write(out, cache_version);
+      write(out, hash);
+
+      write(out, uint32_t(symbols.size() - builtin_symbol::count));
+      for (auto sym = symbol_t(builtin_symbol::count); sym < symbols.size(); ++sym) {
+         auto &n = symbols.name(sym);
+         write(out, uint32_t(n.size()));
+         out.write(n.data(), n.size());
+      }
+
+      write(out, uint32_t(forms.size()));
+      for (auto &f : forms) {
+         write(out, uint8_t(f.type));
+         write_elements(out, f.elements);
+      }
+
+      write(out, uint32_t(operators.size()));
+      for (symbol_t op = 0; op < operators.size(); ++op) {
+         write(out, int32_t(operators.get(op).precedence));
+         write(out, uint8_t(operators.get(op).assoc));
+      }
+
+      write(out, uint32_t(statements.size()));
+      for (auto &s : statements) {
+         write(out, s.first);
+         write(out, uint32_t(s.second.size()));
+         for (auto index : s.second) {
+            write(out, index);
+         }
+      }
+
+      write(out, uint32_t(infix.size()));
+      for (auto &i : infix) {
+         write(out, i.first);
+         write(out, i.second);
+      }
+
+      write(out, uint32_t(tokens.size()));
+      for (symbol_t sym = 0; sym < tokens.size(); ++sym) {
+         write(out, uint8_t(tokens[sym]));
+      }
+
+      return bool(out);
+   }
+
+   /** Reads a table written by save() into this one, which must be empty.
+    * Returns false if the file is missing, damaged, from another version,
+    * or was compiled from declarations with a different hash. */
+   auto
+   load(const string &path, uint64_t hash) -> bool {
+      std::ifstream in(path.c_str(), std::ios::binary);
+
+      char magic[4];
+      uint32_t version;
+      uint64_t cached_hash;
+
+      if (!in.read(magic, 4) || std::string(magic, 4) != "AMSX" || !read(in, version)
+          || version != cache_version || !read(in, cached_hash) || cached_hash != hash) {
+         return false;
+      }
+
+      uint32_t count;
+      if (!read(in, count)) {
+         return false;
+      }
+
+      for (uint32_t i = 0; i < count; ++i) {
+         uint32_t length;
+         if (!read(in, length)) {
+            return false;
+         }
+
+         string n(length, '\0');
+         if (!in.read(&n[0], length) || symbols.intern(n) != builtin_symbol::count + i) {
+            return false;
+         }
+      }
+
+      if (!read(in, count)) {
+         return false;
+      }
+
+      forms.resize(count);
+      for (auto &f : forms) {
+         uint8_t type;
+         if (!read(in, type) || !read_elements(in, f.elements)) {
+            return false;
+         }
+
+         f.type = syntax_form_type(type);
+      }
+
+      if (!read(in, count)) {
+         return false;
+      }
+
+      for (symbol_t op = 0; op < count; ++op) {
+         int32_t precedence;
+         uint8_t assoc;
+         if (!read(in, precedence) || !read(in, assoc)) {
+            return false;
+         }
+
+         operators.add(op, precedence, associativity(assoc));
+      }
+
+      if (!read(in, count)) {
+         return false;
+      }
+
+      for (uint32_t i = 0; i < count; ++i) {
+         symbol_t keyword;
+         uint32_t n;
+         if (!read(in, keyword) || !read(in, n)) {
+            return false;
+         }
+
+         auto &indexes = statements[keyword];
+         indexes.resize(n);
+         for (auto &index : indexes) {
+            if (!read(in, index)) {
+               return false;
+            }
+         }
+      }
+
+      if (!read(in, count)) {
+         return false;
+      }
+
+      for (uint32_t i = 0; i < count; ++i) {
+         symbol_t op;
+         uint32_t index;
+         if (!read(in, op) || !read(in, index)) {
+            return false;
+         }
+
+         infix[op] = index;
+      }
+
+      if (!read(in, count)) {
+         return false;
+      }
+
+      tokens.resize(count);
+      for (symbol_t sym = 0; sym < count; ++sym) {
+         uint8_t used;
+         if (!read(in, used)) {
+            return false;
+         }
+
+         tokens[sym] = used != 0;
+      }
+
+      return true;
+   }
+
+   /**
+    * Loads the syntax declared by every .am file in dir. If cache_path
+    * names a table compiled from exactly the same declarations it is
+    * used as is; otherwise the declarations are compiled and the cache
+    * is rewritten. An empty cache_path disables caching. A missing
+    * directory yields a table with only the builtin operators.
+    */
+   static auto
+   load_directory(const string &dir, const string &cache_path = string()) -> syntax_table_ptr_t {
+      std::vector<string> files;
+
+      if (auto d = opendir(dir.c_str())) {
+         while (auto entry = readdir(d)) {
+            string n = entry->d_name;
+            if (n.size() > 3 && n.compare(n.size() - 3, 3, ".am") == 0) {
+               files.push_back(dir + "/" + n);
+            }
+         }
+
+         closedir(d);
+      }
+
+      // Compile in a fixed order, so that symbols are assigned the same
+      // way every time.
+      std::sort(files.begin(), files.end());
+
+      std::vector<string> texts;
+      uint64_t hash = 14695981039346656037ull;
+      auto mix = [&hash](const string &s) {
+         // With a terminator, so that names and texts can't run into each
+         // other.
+         hash = hash_bytes(s.data(), s.size(), hash);
+         hash = hash_bytes("\xff", 1, hash);
+      };
+
+      for (auto &f : files) {
+         texts.push_back(pegtl::read_string(f));
+         mix(f);
+         mix(texts.back());
+      }
+
+      auto table = syntax_table_ptr_t(new syntax_table());
+      if (!cache_path.empty() && table->load(cache_path, hash)) {
+         table->fingerprint = hash;
+         return table;
+      }
+
+      table = syntax_table_ptr_t(new syntax_table());
+      for (std::size_t i = 0; i < files.size(); ++i) {
+         table->compile(texts[i], files[i]);
+      }
+
+      if (!cache_path.empty()) {
+         table->save(cache_path, hash);
+      }
+
+      table->fingerprint = hash;
+      return table;
+   }
+};
+
+//=====----------------------------------------------------------------------======//
+//      Syntax Declaration Grammar
+//=====----------------------------------------------------------------------======//
+
+namespace syntax_grammar {
+
+using namespace pegtl;
+
+/** Starts declaring an expression form. */
+struct begin_expr : action_base<begin_expr> {
+   static void
+   apply(const match_view &v, syntax_compiler &c) {
+      c.form.type = syntax_form_type::expr;
+      c.form.precedence = 0;
+      c.lists.assign(1, syntax_element_list_t());
+   }
+};
+
+/** Starts declaring a statement form. */
+struct begin_statement : action_base<begin_statement> {
+   static void
+   apply(const match_view &v, syntax_compiler &c) {
+      c.form.type = syntax_form_type::statement;
+      c.form.precedence = 0;
+      c.lists.assign(1, syntax_element_list_t());
+   }
+};
+
+/** Adds an element which has no token or nested elements. */
+template<syntax_element_type et>
+   struct add_element : action_base<add_element<et> > {
+      static void
+      apply(const match_view &v, syntax_compiler &c) {
+         syntax_element e = { et, no_symbol, syntax_element_list_t() };
+         c.lists.back().push_back(e);
+      }
+   };
+
+/** Sets the precedence of the form being declared. */
+struct set_precedence : action_base<set_precedence> {
+   static void
+   apply(const match_view &v, syntax_compiler &c) {
+      c.form.precedence = std::atoi(string(c.text + v.offset, v.length).c_str());
+      if (c.form.precedence == 0) {
+         throw pegtl::parse_error("a precedence must be at least 1");
+      }
+   }
+};
+
+/** Adds a keyword or operator. */
+struct add_token : action_base<add_token> {
+   static void
+   apply(const match_view &v, syntax_compiler &c) {
+      auto sym = c.table.get_symbols().intern(c.text + v.offset, v.length);
+      syntax_element e = { syntax_element_type::token, sym, syntax_element_list_t() };
+      c.lists.back().push_back(e);
+   }
+};
+
+struct begin_repeat : action_base<begin_repeat> {
+   static void
+   apply(const match_view &v, syntax_compiler &c) {
+      c.lists.push_back(syntax_element_list_t());
+   }
+};
+
+struct end_repeat : action_base<end_repeat> {
+   static void
+   apply(const match_view &v, syntax_compiler &c) {
+      syntax_element e = { syntax_element_type::repeat, no_symbol, c.lists.back() };
+      c.lists.pop_back();
+      c.lists.back().push_back(e);
+   }
+};
+
+/** Adds the declared form to the table. */
+struct end_form : action_base<end_form> {
+   static void
+   apply(const match_view &v, syntax_compiler &c) {
+      c.form.elements = c.lists.back();
+      c.table.add_form(c.form);
+   }
+};
+
+struct comment : seq<one<'#'>, star<not_one<'\n'> > > {
+};
+
+struct word : seq<sor<alpha, one<'_'> >, star<sor<alnum, one<'_'> > > > {
+};
+
+/** Operators may use any of the characters expressions do, except those
+ * the declarations themselves use. */
+struct op : plus<one<'+', '-', '*', '/', '&', '|', '^', '=', '<', '>', ':', ';', '[', ']', ',', '.',
+                     '?', '\\', '~', '!', '@', '$', '%'> > {
+};
+
+struct element;
+
+struct repeat : seq<ifapply_view<one<'{'>, begin_repeat>, star<blank>, plus<element>,
+      ifapply_view<pegtl::string<'}', '*'>, end_repeat> > {
+};
+
+struct element : seq<
+      sor<ifapply_view<pegtl::string<'(', ':', ')'>, add_element<syntax_element_type::block> >,
+          ifapply_view<pegtl::string<'(', ')'>, add_element<syntax_element_type::hole> >,
+          repeat,
+          ifapply_view<sor<word, op>, add_token> >,
+      star<blank> > {
+};
+
+struct kind : sor<ifapply_view<pegtl::string<'e', 'x', 'p', 'r'>, begin_expr>,
+      ifapply_view<pegtl::string<'s', 't', 'a', 't', 'e', 'm', 'e', 'n', 't'>, begin_statement> > {
+};
+
+struct precedence : seq<plus<blank>, ifapply_view<plus<digit>, set_precedence> > {
+};
+
+/** A form, which may end the file without a newline. */
+struct form : seq<kind, opt<precedence>, plus<blank>, pegtl::string<'<', '-'>, plus<blank>, plus<element>,
+      opt<comment>, ifapply_view<sor<eol, eof>, end_form> > {
+};
+
+struct line : seq<star<blank>, sor<form, seq<opt<comment>, sor<eol, eof> > > > {
+};
+
+struct grammar : until<eof, line> {
+};
+
+} // end syntax_grammar namespace
+
+inline void
+syntax_table::compile(const string &text, const string &name) {
+   syntax_compiler c = { *this, text.data(), syntax_form(), std::vector<syntax_element_list_t>() };
+
+   pegtl::forward_input<const char *, pegtl::ascii_location> in(text.data(), text.data() + text.size());
+
+   try {
+      pegtl::basic_parse<syntax_grammar::grammar>(in, c);
+   } catch (const pegtl::parse_error &e) {
+      throw pegtl::parse_error(name + ": " + e.what());
+   }
+
+   fingerprint = hash_bytes(text.data(), text.size(), fingerprint);
+}
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* SYNTAX_H_ */
@@ -0,0 +1,192 @@
+/*
+ * type_context.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TYPE_CONTEXT_H_
+#define TYPE_CONTEXT_H_
+
+#include <map>
+#include <mutex>
+
+#include "annotations.h"
+
+namespace amalgam {
+namespace parser {
+
+/**
+ * Hands out one canonical annotation per distinct type, so that two types
+ * are the same exactly when their pointers are, and a type used by many
+ * nodes is only allocated once.
+ *
+ * Canonical annotations are shared by everything which uses the type, so
+ * they must not be changed once they have been handed out. Build a new
+ * annotation and intern() it instead.
+ *
+ * Methods may be verified on several threads at once, so interning is
+ * serialized. The integer types never change, and need no lock.
+ */
+class type_context {
+   /** The integer types, by signedness and then by size, for literals,
+    * which need them most often. */
+   type_annotation::ptr_t integers[2][4];
+
+   /** Every canonical type, by a key spelling out its structure. */
+   std::map<string, type_annotation::ptr_t> interned;
+
+   /** Guards interned. It is recursive, since interning a type interns
+    * its parts. */
+   std::recursive_mutex lock;
+
+   static auto
+   size_index(uint8_t size_in_bits) -> int {
+      switch (size_in_bits) {
+         case 8:
+            return 0;
+         case 16:
+            return 1;
+         case 32:
+            return 2;
+         case 64:
+            return 3;
+      }
+
+      return -1;
+   }
+
+   static void
+   append_list_key(string &k, const type_annotation::list_ptr_t &l) {
+      if (!l) {
+         k += "-";
+         return;
+      }
+
+      k += "(";
+      for (auto &t : *l) {
+         append_key(k, *t);
+         k += ",";
+      }
+      k += ")";
+   }
+
+   /** Spells out everything which makes one type differ from another. The
+    * literal specifier of a number is how it was written, not part of its
+    * type, so it is left out. */
+   static void
+   append_key(string &k, const type_annotation &t) {
+      k += std::to_string(int(t.id)) + ":" + t.name + ":" + (t.is_constant ? "c" : "") + (t.is_vector ? "v" : "")
+           + (t.is_array ? "a" : "") + std::to_string(t.size_in_elements);
+
+      switch (t.id) {
+         case type_annotation::type_id::integer:
+         case type_annotation::type_id::floating_point: {
+            auto &n = static_cast<const numeric_type_annotation &>(t);
+            k += (n.is_signed ? "s" : "u") + std::to_string(int(n.size_in_bits));
+         }
+            break;
+
+         case type_annotation::type_id::astruct:
+         case type_annotation::type_id::tuple:
+         case type_annotation::type_id::dict:
+            append_list_key(k, static_cast<const composite_type_annotation &>(t).children);
+            break;
+
+         case type_annotation::type_id::method: {
+            auto &m = static_cast<const method_type_annotation &>(t);
+            append_list_key(k, m.input);
+            append_list_key(k, m.output);
+         }
+            break;
+
+         default:
+            break;
+      }
+   }
+
+   /** Replaces the types in a list with their canonical ones. */
+   void
+   intern_list(type_annotation::list_ptr_t &l) {
+      if (l) {
+         for (auto &t : *l) {
+            t = intern(t);
+         }
+      }
+   }
+
+public:
+   type_context() {
+      for (auto is_signed = 0; is_signed < 2; ++is_signed) {
+         for (auto size = 0; size < 4; ++size) {
+            auto t = new numeric_type_annotation(type_annotation::type_id::integer);
+            t->is_signed = is_signed;
+            t->size_in_bits = uint8_t(8 << size);
+
+            integers[is_signed][size] = intern(type_annotation::ptr_t(t));
+         }
+      }
+   }
+
+   /** Gets the integer type of a size, which must be 8, 16, 32 or 64 bits. */
+   auto
+   integer(bool is_signed, uint8_t size_in_bits) const -> const type_annotation::ptr_t & {
+      return integers[is_signed][size_index(size_in_bits)];
+   }
+
+   /** Gets the canonical annotation for the type t describes. t becomes the
+    * canonical one if the type has not been seen before. */
+   auto
+   intern(type_annotation::ptr_t t) -> type_annotation::ptr_t {
+      if (!t) {
+         return t;
+      }
+
+      string k;
+      append_key(k, *t);
+
+      std::lock_guard<std::recursive_mutex> guard(lock);
+
+      auto it = interned.find(k);
+      if (it != interned.end()) {
+         return it->second;
+      }
+
+      // A new canonical type refers to the canonical types of its parts,
+      // so that they compare by pointer too.
+      if (t->id == type_annotation::type_id::method) {
+         auto &m = static_cast<method_type_annotation &>(*t);
+         intern_list(m.input);
+         intern_list(m.output);
+      } else if (t->id == type_annotation::type_id::astruct || t->id == type_annotation::type_id::tuple
+                 || t->id == type_annotation::type_id::dict) {
+         intern_list(static_cast<composite_type_annotation &>(*t).children);
+      }
+
+      return interned[k] = t;
+   }
+
+   /** Spells out the structure of a type. Two types are the same exactly
+    * when their keys are. */
+   static auto
+   key(const type_annotation &t) -> string {
+      string k;
+      append_key(k, t);
+      return k;
+   }
+
+   /** The number of distinct types. */
+   auto
+   size() -> std::size_t {
+      std::lock_guard<std::recursive_mutex> guard(lock);
+      return interned.size();
+   }
+};
+
+/** The type for pointers to type contexts, which may be shared by several
+ * modules. */
+typedef std::shared_ptr<type_context> type_context_ptr_t;
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* TYPE_CONTEXT_H_ */
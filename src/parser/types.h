@@ -17,6 +17,17 @@ namespace parser {
 /** The type for strings in the parser. */
 typedef std::string string;
 
+/** Hashes bytes with 64-bit FNV-1a. To hash several pieces in a row, pass
+ * the hash of the pieces so far as the seed. */
+inline auto
+hash_bytes(const char *data, std::size_t size, uint64_t seed = 14695981039346656037ull) -> uint64_t {
+   for (std::size_t i = 0; i < size; ++i) {
+      seed = (seed ^ (unsigned char) data[i]) * 1099511628211ull;
+   }
+
+   return seed;
+}
+
 } // end parser namespace
 } // end fusion namespace
 
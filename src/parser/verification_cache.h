@@ -0,0 +1,91 @@
+/*
+ * verification_cache.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef VERIFICATION_CACHE_H_
+#define VERIFICATION_CACHE_H_
+
+#include <map>
+#include <vector>
+
+#include "annotations.h"
+#include "type_context.h"
+
+namespace amalgam {
+namespace parser {
+
+/** What verifying one method found, kept so that it need not be verified
+ * again while neither it nor anything it depends on has changed. */
+struct verified_method {
+   /** A hash of the method's trees. */
+   uint64_t source_hash;
+
+   /** The names the method uses but does not declare, each with a
+    * fingerprint of what the name meant when the method was verified. */
+   std::vector<std::pair<string, uint64_t> > dependencies;
+
+   /** The semantic type of every node, in flat tree order. */
+   type_annotation::list_t semantic_types;
+
+   /** The variables the method declares. */
+   std::vector<std::pair<string, type_annotation::ptr_t> > variables;
+};
+
+/** The type for the verified methods of a module, by name. */
+typedef std::map<string, verified_method> verified_method_map_t;
+
+/**
+ * Remembers the methods of each module which passed verification, by the
+ * path of the module, so that when the module is parsed again only the
+ * methods which changed are verified again.
+ *
+ * Semantic types are only comparable within one type context, so every
+ * parse of a module must share the context the cache hands out for its
+ * path. The verifier ignores the cache for modules which do not.
+ */
+class verification_cache {
+   struct entry {
+      type_context_ptr_t types;
+      verified_method_map_t methods;
+   };
+
+   std::map<string, entry> modules;
+
+public:
+   /** Gets the type context shared by every parse of the module at path. */
+   auto
+   get_type_context(const string &path) -> type_context_ptr_t {
+      auto &e = modules[path];
+      if (!e.types) {
+         e.types.reset(new type_context());
+      }
+
+      return e.types;
+   }
+
+   /** Gets the methods verified the last time the module at path was,
+    * or nullptr if they can not be used with the type context types. */
+   auto
+   find(const string &path, const type_context &types) -> const verified_method_map_t * {
+      auto it = modules.find(path);
+      if (it == modules.end() || it->second.types.get() != &types) {
+         return nullptr;
+      }
+
+      return &it->second.methods;
+   }
+
+   /** Replaces what is remembered about the module at path, so that
+    * methods which have since been removed are forgotten. */
+   void
+   replace(const string &path, verified_method_map_t &&methods) {
+      modules[path].methods = std::move(methods);
+   }
+};
+
+} // end parser namespace
+} // end amalgam namespace
+
+#endif /* VERIFICATION_CACHE_H_ */
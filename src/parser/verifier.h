@@ -8,127 +8,160 @@
 #ifndef VERIFIER_H_
 #define VERIFIER_H_
 
+#include <algorithm>
+#include <atomic>
+#include <set>
+#include <thread>
+
+#include "inference.h"
 #include "module.h"
-#include "../util/strutil.h"
+#include "verification_cache.h"
 
 namespace amalgam {
 namespace parser {
 
 class verifier {
 
+   /** The type for the errors found in one method, in the order they were
+    * found. */
+   typedef std::vector<string> error_list_t;
+
    module_ptr_t module;
    bool verbose;
 
+   /** How many methods may be verified at once. */
+   unsigned threads;
+
+   /** Where the methods verified before are remembered, or nullptr. */
+   verification_cache* cache;
+
+   /** How many methods the last call to verify() took from the cache. */
+   std::size_t reused;
+
+   /** The names the module imports from other modules. */
+   std::set<symbol_t> imported;
+
    /** Determines if the expression is an lvalue. If it is, this method
     * will return true. Otherwise it will return false.
     */
    bool
-   is_lvalue(ast_ptr_t e) {
-      if (e->type == node_type::identifier) {
+   is_lvalue(const flat_tree& t, node_index_t e) {
+      if (t.type(e) == node_type::identifier) {
          return true;
       }
       return false;
    }
 
-   /** Find the most significant set bit. */
-   template<typename T>
-      auto
-      get_most_significant_bit(T value) -> int {
-         auto r = 0;
-
-         // Find the most significant bit set. This will tell us how big the integer has to be,
-         // in bits.
-         while (value >>= 1) {
-            ++r;
-         }
-
-         return r;
-      }
-
-   type_annotation::ptr_t
-   get_int_type(const string& token) {
-      auto base = 10;
-      auto is_signed = true;
-
-      auto num_spec = split_literal_int(token);
-
-      if (num_spec.second.size()) {
-         if (num_spec.second == "h") {
-            base = 16;
-         } else if (num_spec.second == "b") {
-            base = 2;
-         } else if (num_spec.second == "o") {
-            base = 8;
-         } else if (num_spec.second == "Uh") {
-            base = 16;
-            is_signed = false;
-         } else if (num_spec.second == "Ub") {
-            base = 2;
-            is_signed = false;
-         } else if (num_spec.second == "Uo") {
-            base = 8;
-            is_signed = false;
-         } else {
-            // Unknown specifier. This needs to be handled by
-            // checking the module for literal handlers.
-         }
-      }
-
-      // Figure out how big the integer has to be.
-      int msb;
-      if (is_signed) {
-         msb = get_most_significant_bit(std::stoll(num_spec.first,
-                                                   nullptr,
-                                                   base));
-      } else {
-         msb = get_most_significant_bit(std::stoull(num_spec.first,
-                                                    nullptr,
-                                                    base));
-      }
-
-      auto t = new numeric_type_annotation(type_annotation::type_id::integer);
-
-      t->is_signed = is_signed;
-      t->specifier = num_spec.second;
-
-      if (msb <= 8) {
-         t->size_in_bits = 8;
-      } else if (msb <= 16) {
-         t->size_in_bits = 16;
-      } else if (msb <= 32) {
-         t->size_in_bits = 32;
-      } else if (msb <= 64) {
-         t->size_in_bits = 64;
-      }
-
-      return type_annotation::ptr_t(t);
-   }
+   /** Solves the types of the tree rooted at e, and annotates every node
+    * in it. Each node is a type variable, constrained by what it is:
+    * literals need a type which holds them, identifiers have the type of
+    * the variable they name, and the operands of arithmetic and
+    * comparisons must have the same type, which arithmetic also gives its
+    * result. The identifier an initializer declares is left for the right
+    * hand side to decide. Returns false if the constraints conflict, or an
+    * identifier names no variable.
+    *
+    * Method calls and generic parameters are not constrained: the grammar
+    * has neither yet, and variables are declared only by initializing
+    * them, so these are the only constraints there are to solve. */
+   bool
+   infer(method_ptr_t m, node_index_t e, type_inference& solver, error_list_t& errors) {
+      auto& t = m->get_flat_tree();
+      auto end = t.next_sibling(e);
+      auto declared = (t.type(e) == node_type::op && t.symbol(e) == builtin_symbol::init) ? t.first_child(e) : end;
 
-   /** Check the tree and get the type of the node by evaluating the type information. */
-   type_annotation::ptr_t
-   get_type(ast_ptr_t e) {
-      if (e->semantic_type) {
-         return e->semantic_type;
-      }
+      // Statements from lib/syntax may declare names of their own, such as
+      // the variable of a for loop, which the verifier does not know about
+      // yet.
+      auto in_statement = t.type(e) == node_type::statement;
+
+      solver.reset(end - e);
 
-      switch (e->type) {
-         case node_type::op: {
-            auto l_type = get_type(e->children[0]);
-            auto r_type = get_type(e->children[1]);
+      // Children come after their parents in the flat tree, so a backwards
+      // sweep constrains every child before its parent links to it.
+      auto passed = true;
+      std::vector<node_index_t> unknown;
+      for (auto n = end; n-- > e;) {
+         auto v = n - e;
 
-            if (!l_type || !r_type || l_type != r_type) {
+         switch (t.type(n)) {
+            case node_type::literal_int:
+               solver.bind_literal(v, t.literal(n));
                break;
+
+            case node_type::identifier: {
+               if (n == declared) {
+                  break;
+               }
+
+               auto type = m->find_variable(t.symbol(n));
+               if (type) {
+                  solver.bind(v, type);
+               } else if (!in_statement) {
+                  unknown.push_back(n);
+               }
             }
+               break;
+
+            case node_type::group:
+               if (t.child_count(n) == 1) {
+                  solver.unify(v, t.first_child(n) - e);
+               }
+               break;
+
+            case node_type::op: {
+               auto op = t.symbol(n);
+               auto left = t.first_child(n) - e;
+
+               if (t.child_count(n) == 1) {
+                  // Only the sign operators have a prefix form.
+                  if (op == builtin_symbol::add || op == builtin_symbol::sub) {
+                     solver.unify(v, left);
+                  }
+                  break;
+               }
+
+               if (t.child_count(n) != 2 || !(is_arithmetic(op) || is_comparison(op) || op == builtin_symbol::init)) {
+                  break;
+               }
+
+               auto right = t.next_sibling(t.first_child(n)) - e;
+               if (!solver.unify(left, right)) {
+                  errors.push_back("the operands of '" + module->get_symbols()->name(op) + "' have different types: "
+                                   + solver.describe(left) + " and " + solver.describe(right));
+                  passed = false;
+                  break;
+               }
+
+               // There is no boolean type yet, so comparisons are left
+               // untyped.
+               if (is_arithmetic(op)) {
+                  solver.unify(v, left);
+               }
+            }
+               break;
+
+            default:
+               break;
          }
-            break;
+      }
 
-         case node_type::literal_int: {
-            e->semantic_type = get_int_type(e->data);
+      // The sweep went backwards, so report names in the order they were
+      // written, each only once.
+      std::set<symbol_t> reported;
+      for (auto it = unknown.rbegin(); it != unknown.rend(); ++it) {
+         if (reported.insert(t.symbol(*it)).second) {
+            errors.push_back("unknown variable '" + module->get_symbols()->name(t.symbol(*it)) + "'");
+            passed = false;
          }
-            break;
       }
 
-      return e->semantic_type;
+      auto& types = module->get_type_context();
+      for (auto n = e; n < end; ++n) {
+         t.set_semantic_type(n, solver.resolve(n - e, types));
+      }
+
+      return passed;
    }
 
    /** Evaluate the tree and provide type annotations for each element in the tree. Also check
@@ -136,41 +169,50 @@ class verifier {
     * book-keeping for the method regarding variable presence and initialization.
     */
    bool
-   expression_tree(method_ptr_t m, ast_ptr_t e) {
+   expression_tree(method_ptr_t m, node_index_t e, type_inference& solver, error_list_t& errors) {
+      auto& t = m->get_flat_tree();
+
       // If we have an initialization operator, the left side
       // must be an identifier.
-      if (e->type == node_type::op) {
-         if (e->data == ":=") {
-            if (e->children.size() == 0 || (!is_lvalue(e->children[0]))) {
-               return false;
-            }
-
-            // Get the type of the rvalue
-            auto r_type = get_type(e->children[1]);
-            if (!r_type) {
-               std::cout << "error: unable to infer type for the right hand side of the initializer" << std::endl;
-               return false;
-            }
-
-            e->children[0]->semantic_type = r_type;
-            m->add_variable(e->children[0]->data, r_type);
-         } else {
-            auto l_type = get_type(e->children[0]);
-            auto r_type = get_type(e->children[1]);
+      if (t.type(e) == node_type::op && t.symbol(e) == builtin_symbol::init) {
+         if (t.child_count(e) < 2 || (!is_lvalue(t, t.first_child(e)))) {
+            return false;
+         }
+      }
 
+      if (!infer(m, e, solver, errors)) {
+         return false;
+      }
 
+      if (t.type(e) == node_type::op && t.symbol(e) == builtin_symbol::init) {
+         auto left = t.first_child(e);
 
+         auto& r_type = t.semantic_type(t.next_sibling(left));
+         if (!r_type) {
+            errors.push_back("unable to infer type for the right hand side of the initializer");
+            return false;
          }
+
+         m->add_variable(t.symbol(left), r_type);
       }
 
       return true;
    }
 
+   /** Verifies one method. A method reads the variables of the methods
+    * enclosing it, and adds its own, so it must be verified after those
+    * methods. Apart from that, methods only share the module, which is
+    * not changed while verifying apart from interning types, so any number
+    * of them at one level of nesting can be verified at once. */
    bool
-   method(method_ptr_t m) {
+   method(method_ptr_t m, error_list_t& errors) {
+      // The solver is kept for the whole method so its tables are only
+      // allocated once.
+      type_inference solver;
+
       auto passed = true;
-      for (auto e : m->get_expression_tree_list()) {
-         if (!expression_tree(m, e)) {
+      for (auto e : m->get_flat_tree().get_roots()) {
+         if (!expression_tree(m, e, solver, errors)) {
             passed = false;
          }
       }
@@ -178,20 +220,274 @@ class verifier {
       return passed;
    }
 
+   //=====----------------------------------------------------------------------======//
+   //      Incremental Verification
+   //=====----------------------------------------------------------------------======//
+
+   /** Hashes the trees of a method. Symbols are hashed by their text, since
+    * every parse numbers them afresh, and positions are left out, so that
+    * a method which has only moved is not verified again. */
+   auto
+   source_hash(method_ptr_t m) -> uint64_t {
+      auto& t = m->get_flat_tree();
+      auto& symbols = *module->get_symbols();
+
+      auto h = hash_bytes(nullptr, 0);
+      for (node_index_t n = 0; n < t.size(); ++n) {
+         auto type = uint8_t(t.type(n));
+         auto count = t.child_count(n);
+         h = hash_bytes(reinterpret_cast<const char*>(&type), sizeof(type), h);
+         h = hash_bytes(reinterpret_cast<const char*>(&count), sizeof(count), h);
+
+         if (t.symbol(n) != no_symbol) {
+            auto& name = symbols.name(t.symbol(n));
+            auto size = uint32_t(name.size());
+            h = hash_bytes(reinterpret_cast<const char*>(&size), sizeof(size), h);
+            h = hash_bytes(name.data(), name.size(), h);
+         }
+      }
+
+      return h;
+   }
+
+   /** Fingerprints what a name used in m, but not declared by it, means:
+    * the variable of an enclosing method or imported from another module,
+    * the type, the method, or the imported methods it names, if any. */
+   auto
+   fingerprint(method_ptr_t m, const string& name) -> uint64_t {
+      string k;
+
+      // A name m does not declare is either imported, which puts it in
+      // __default__, or else looked up in the enclosing methods, so m's
+      // own lookup finds both.
+      auto sym = module->get_symbols()->lookup(name);
+      auto v = (sym == no_symbol) ? nullptr : m->find_variable(sym);
+      if (v) {
+         k += "v" + type_context::key(*v);
+      }
+
+      auto t = module->get_type(name);
+      if (t) {
+         k += "t" + type_context::key(*t);
+      }
+
+      if (module->has_method(name)) {
+         k += "m" + type_context::key(module->get_method(name)->get_type());
+      }
+
+      auto imported = module->find_imported_method(name);
+      if (imported) {
+         for (auto& signature : *imported) {
+            k += "i" + type_context::key(*signature);
+         }
+      }
+
+      return hash_bytes(k.data(), k.size());
+   }
+
+   /** Records what verifying a method found, for the cache. */
+   auto
+   remember(method_ptr_t m, uint64_t hash) -> verified_method {
+      auto& t = m->get_flat_tree();
+      auto& symbols = *module->get_symbols();
+
+      verified_method v;
+      v.source_hash = hash;
+
+      std::set<symbol_t> seen;
+      for (node_index_t n = 0; n < t.size(); ++n) {
+         v.semantic_types.push_back(t.semantic_type(n));
+
+         // Imported variables are kept with the ones __default__ declares,
+         // but change with the module they come from.
+         auto sym = t.symbol(n);
+         auto outside = !m->has_variable(sym) || imported.count(sym);
+         if (t.type(n) == node_type::identifier && outside && seen.insert(sym).second) {
+            v.dependencies.push_back(std::make_pair(symbols.name(sym), fingerprint(m, symbols.name(sym))));
+         }
+      }
+
+      for (auto& var : m->get_variables()) {
+         if (!imported.count(var.first)) {
+            v.variables.push_back(std::make_pair(symbols.name(var.first), var.second));
+         }
+      }
+
+      return v;
+   }
+
+   /** Applies what was remembered about a method, if neither the method
+    * nor anything it depends on has changed since. Returns false if the
+    * method has to be verified again. */
+   auto
+   reuse(method_ptr_t m, uint64_t hash, const verified_method& v) -> bool {
+      auto& t = m->get_flat_tree();
+      if (v.source_hash != hash || v.semantic_types.size() != t.size()) {
+         return false;
+      }
+
+      for (auto& d : v.dependencies) {
+         if (fingerprint(m, d.first) != d.second) {
+            return false;
+         }
+      }
+
+      for (node_index_t n = 0; n < t.size(); ++n) {
+         t.set_semantic_type(n, v.semantic_types[n]);
+      }
+
+      for (auto& var : v.variables) {
+         m->add_variable(module->get_symbols()->intern(var.first), var.second);
+      }
+
+      return true;
+   }
+
 public:
+   /** Creates a verifier which verifies up to threads methods at once. Zero
+    * means one per core. */
+   verifier(unsigned _threads = 1) :
+            verbose(false), threads(_threads), cache(nullptr), reused(0) {
+      if (threads == 0) {
+         threads = std::max(1u, std::thread::hardware_concurrency());
+      }
+   }
+
+   /** Has verify() remember the methods which pass in a cache, and take
+    * the methods which are unchanged since from it rather than verify
+    * them again. Only modules which share the type context the cache
+    * holds for their path use it. */
+   void
+   set_cache(verification_cache* c) {
+      cache = c;
+   }
+
+   /** Gets how many methods the last call to verify() took from the cache. */
+   auto
+   get_reused() const -> std::size_t {
+      return reused;
+   }
 
    bool
    verify(module_ptr_t m, bool _verbose = false) {
       module = m;
       verbose = _verbose;
+      reused = 0;
+
+      imported.clear();
+      for (auto& i : m->get_imports()) {
+         for (auto& name : i.names) {
+            imported.insert(m->get_symbols()->intern(name));
+         }
+      }
+
+      std::vector<method_ptr_t> methods;
+      for (auto& me : m->get_method_map()) {
+         methods.push_back(me.second);
+      }
+
+      std::vector<error_list_t> errors(methods.size());
+      std::vector<char> results(methods.size());
+
+      auto previous = cache ? cache->find(m->get_path(), m->get_type_context()) : nullptr;
+      std::vector<uint64_t> hashes(methods.size());
+      std::vector<const verified_method*> kept(methods.size());
+
+      auto try_reuse = [&](std::size_t i) -> bool {
+         if (!previous) {
+            return false;
+         }
 
+         hashes[i] = source_hash(methods[i]);
+
+         auto it = previous->find(methods[i]->get_name());
+         if (it == previous->end() || !reuse(methods[i], hashes[i], it->second)) {
+            return false;
+         }
+
+         kept[i] = &it->second;
+         results[i] = true;
+         ++reused;
+         return true;
+      };
+
+      // Methods may use what the methods enclosing them declare, so they
+      // are settled one level of nesting at a time, starting with
+      // __default__, before deciding which of the next level have to be
+      // verified again.
+      std::vector<std::vector<std::size_t> > levels;
+      for (std::size_t i = 0; i < methods.size(); ++i) {
+         std::size_t depth = 0;
+         for (auto e = methods[i]->get_enclosing(); e; e = e->get_enclosing()) {
+            ++depth;
+         }
+
+         if (levels.size() <= depth) {
+            levels.resize(depth + 1);
+         }
+
+         levels[depth].push_back(i);
+      }
+
+      for (auto& level : levels) {
+         std::vector<std::size_t> pending;
+         for (auto i : level) {
+            if (!try_reuse(i)) {
+               pending.push_back(i);
+            }
+         }
+
+         // Workers take the next method until there are none left, so a
+         // few large methods do not hold up the rest.
+         std::atomic<std::size_t> next(0);
+         auto work = [&]() {
+            for (std::size_t p; (p = next++) < pending.size();) {
+               auto i = pending[p];
+               results[i] = method(methods[i], errors[i]);
+            }
+         };
+
+         std::vector<std::thread> workers;
+         for (auto n = std::min<std::size_t>(threads, pending.size()); n > 1; --n) {
+            workers.push_back(std::thread(work));
+         }
+
+         work();
+
+         for (auto& w : workers) {
+            w.join();
+         }
+      }
+
+      // Errors are printed in the order of the methods rather than the
+      // order they were found in, so the output is the same however the
+      // work was split up.
       auto passed = true;
-      for (auto me : m->get_method_map()) {
-         if (!method(me.second)) {
+      for (std::size_t i = 0; i < methods.size(); ++i) {
+         for (auto& e : errors[i]) {
+            std::cout << "error: " << e << std::endl;
+         }
+
+         if (!results[i]) {
             passed = false;
          }
       }
 
+      // Methods which failed are not remembered, so that their errors are
+      // reported again next time.
+      if (previous) {
+         verified_method_map_t now;
+         for (std::size_t i = 0; i < methods.size(); ++i) {
+            if (kept[i]) {
+               now[methods[i]->get_name()] = *kept[i];
+            } else if (results[i]) {
+               now[methods[i]->get_name()] = remember(methods[i], hashes[i]);
+            }
+         }
+
+         cache->replace(m->get_path(), std::move(now));
+      }
+
       return passed;
    }
 };
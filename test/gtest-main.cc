@@ -32,6 +32,15 @@
 #include "gtest.h"
 #include "parser/test_module.h"
 #include "parser/test_parser.h"
+#include "parser/test_expression_builder.h"
+#include "parser/test_flat_tree.h"
+#include "parser/test_folder.h"
+#include "parser/test_lexer.h"
+#include "parser/test_literals.h"
+#include "parser/test_memo.h"
+#include "parser/test_runs.h"
+#include "parser/test_symbols.h"
+#include "parser/test_syntax.h"
 #include "parser/test_verifier.h"
 #include "codegen/test_codegen.h"
 #include "machine/test_template.h"
@@ -0,0 +1,135 @@
+/*
+ * test_expression_builder.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TEST_EXPRESSION_BUILDER_H_
+#define TEST_EXPRESSION_BUILDER_H_
+
+#include "parser/parser.h"
+#include "parser/test_helpers.h"
+
+namespace {
+
+/** Parses a single expression and returns the root of its tree, along
+ * with the module which owns it. It is not verified, so constants are not
+ * folded. */
+auto
+parse_expression(const std::string &s, amalgam::parser::module_ptr_t &m) -> amalgam::parser::node_index_t {
+   amalgam::parser::parser p;
+   m = p.parse_unverified(s);
+
+   if (m == nullptr || trees_of(m).get_roots().empty()) {
+      m = nullptr;
+      return 0;
+   }
+
+   return trees_of(m).get_roots().front();
+}
+
+}
+
+TEST(ExpressionBuilderTest, MultiplicationBindsTighter) {
+   amalgam::parser::module_ptr_t m;
+   auto e = parse_expression("1+2*3", m);
+
+   ASSERT_TRUE(m != nullptr);
+
+   auto &t = trees_of(m);
+   EXPECT_EQ("+", m->get_source_text(t, e));
+   EXPECT_EQ("1", m->get_source_text(t, t.child(e, 0)));
+   EXPECT_EQ("*", m->get_source_text(t, t.child(e, 1)));
+}
+
+TEST(ExpressionBuilderTest, GroupOverridesPrecedence) {
+   amalgam::parser::module_ptr_t m;
+   auto e = parse_expression("(1+2)*3", m);
+
+   ASSERT_TRUE(m != nullptr);
+
+   auto &t = trees_of(m);
+   EXPECT_EQ("*", m->get_source_text(t, e));
+   EXPECT_EQ("+", m->get_source_text(t, t.child(e, 0)));
+   EXPECT_EQ("3", m->get_source_text(t, t.child(e, 1)));
+}
+
+TEST(ExpressionBuilderTest, LeftAssociative) {
+   amalgam::parser::module_ptr_t m;
+   auto e = parse_expression("10-5-2", m);
+
+   ASSERT_TRUE(m != nullptr);
+
+   auto &t = trees_of(m);
+   EXPECT_EQ("-", m->get_source_text(t, t.child(e, 0)));
+   EXPECT_EQ("2", m->get_source_text(t, t.child(e, 1)));
+}
+
+TEST(ExpressionBuilderTest, ComparisonBindsLooserThanArithmetic) {
+   amalgam::parser::module_ptr_t m;
+   auto e = parse_expression("1 < 2 + 3", m);
+
+   ASSERT_TRUE(m != nullptr);
+
+   auto &t = trees_of(m);
+   EXPECT_EQ("<", m->get_source_text(t, e));
+   EXPECT_EQ("1", m->get_source_text(t, t.child(e, 0)));
+   EXPECT_EQ("+", m->get_source_text(t, t.child(e, 1)));
+}
+
+TEST(ExpressionBuilderTest, InitializationBindsLoosest) {
+   amalgam::parser::module_ptr_t m;
+   auto e = parse_expression("x := 5", m);
+
+   ASSERT_TRUE(m != nullptr);
+
+   auto &t = trees_of(m);
+   EXPECT_EQ(":=", m->get_source_text(t, e));
+   EXPECT_EQ("x", m->get_source_text(t, t.child(e, 0)));
+   EXPECT_EQ("5", m->get_source_text(t, t.child(e, 1)));
+}
+
+TEST(ExpressionBuilderTest, UnknownOperator) {
+   amalgam::parser::parser p;
+
+   EXPECT_THROW(p.parse("1 +- 2"), pegtl::parse_error);
+}
+
+TEST(ExpressionBuilderTest, RewindDetachesOperators) {
+   using namespace amalgam::parser;
+   syntax_table syntax;
+   module_ptr_t m(new module("rewind"));
+
+   auto a = make_node(node_type::identifier, 0, 1, m->get_symbols()->intern("a", 1), m);
+   auto b = make_node(node_type::identifier, 4, 1, m->get_symbols()->intern("b", 1), m);
+   auto c = make_node(node_type::identifier, 8, 1, m->get_symbols()->intern("c", 1), m);
+   auto add = make_node(node_type::op, 2, 1, builtin_symbol::add, m);
+   auto sub = make_node(node_type::op, 6, 1, builtin_symbol::sub, m);
+   auto mul = make_node(node_type::op, 6, 1, builtin_symbol::mul, m);
+
+   expression_builder builder(syntax);
+   builder.operand(a);
+   builder.binary_operator(add);
+   builder.operand(b);
+
+   // The minus attaches the plus to its operands, which has to be undone.
+   auto mark = builder.get_mark();
+   builder.binary_operator(sub);
+   EXPECT_EQ(2u, add->children.size());
+
+   builder.rewind(mark);
+   EXPECT_TRUE(add->children.empty());
+
+   builder.binary_operator(mul);
+   builder.operand(c);
+
+   auto e = builder.finish();
+   ASSERT_EQ(add, e);
+   ASSERT_EQ(2u, e->children.size());
+   EXPECT_EQ(a, e->children[0]);
+   EXPECT_EQ(mul, e->children[1]);
+   EXPECT_EQ(b, mul->children[0]);
+   EXPECT_EQ(c, mul->children[1]);
+}
+
+#endif /* TEST_EXPRESSION_BUILDER_H_ */
@@ -0,0 +1,54 @@
+/*
+ * test_flat_tree.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TEST_FLAT_TREE_H_
+#define TEST_FLAT_TREE_H_
+
+#include "parser/parser.h"
+
+TEST(FlatTreeTest, PreOrder) {
+   using amalgam::parser::node_type;
+
+   amalgam::parser::parser p;
+   auto m = p.parse_unverified("1 + 2 * (3 - x)\n4\n");
+   ASSERT_TRUE(m != nullptr);
+
+   auto &t = m->get_method("__default__")->get_flat_tree();
+   ASSERT_EQ(8u, t.size());
+   ASSERT_EQ(2u, t.get_roots().size());
+
+   // + 1 * 2 - 3 x   4, since parentheses only group.
+   node_type types[] = { node_type::op, node_type::literal_int, node_type::op, node_type::literal_int,
+                         node_type::op, node_type::literal_int, node_type::identifier, node_type::literal_int };
+   for (amalgam::parser::node_index_t n = 0; n < t.size(); ++n) {
+      EXPECT_EQ(types[n], t.type(n));
+   }
+
+   EXPECT_EQ(0u, t.get_roots()[0]);
+   EXPECT_EQ(7u, t.get_roots()[1]);
+   EXPECT_EQ(7u, t.next_sibling(0));
+   EXPECT_EQ(2u, t.child(0, 1));
+   EXPECT_EQ(4u, t.child(2, 1));
+   EXPECT_EQ(2u, t.child_count(4));
+   EXPECT_EQ(m->get_symbols()->lookup("x"), t.symbol(6));
+   EXPECT_EQ(13u, t.start_pos(6));
+}
+
+TEST(FlatTreeTest, VerifierAnnotatesSideTable) {
+   amalgam::parser::parser p;
+   auto m = p.parse("x := 300\n");
+   ASSERT_TRUE(m != nullptr);
+
+   auto me = m->get_method("__default__");
+   auto &t = me->get_flat_tree();
+
+   ASSERT_EQ(3u, t.size());
+   ASSERT_TRUE(t.semantic_type(1) != nullptr);
+   EXPECT_EQ(t.semantic_type(2), t.semantic_type(1));
+   EXPECT_TRUE(me->has_variable("x"));
+}
+
+#endif /* TEST_FLAT_TREE_H_ */
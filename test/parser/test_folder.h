@@ -0,0 +1,130 @@
+/*
+ * test_folder.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TEST_FOLDER_H_
+#define TEST_FOLDER_H_
+
+#include "parser/parser.h"
+#include "parser/test_helpers.h"
+
+namespace {
+
+/** Parses and verifies s, which folds its constants. */
+auto
+fold(const std::string &s) -> amalgam::parser::module_ptr_t {
+   amalgam::parser::parser p;
+   return p.parse(s);
+}
+
+}
+
+TEST(FolderTest, FoldsConstants) {
+   using amalgam::parser::node_type;
+
+   auto m = fold("x := 5+(6*10)\n");
+   ASSERT_TRUE(m != nullptr);
+
+   auto &t = trees_of(m);
+   ASSERT_EQ(3u, t.size());
+   EXPECT_EQ(node_type::literal_int, t.type(2));
+   EXPECT_EQ(65, t.literal(2).as_signed());
+   EXPECT_EQ("65", m->get_symbols()->name(t.symbol(2)));
+   EXPECT_EQ(5u, t.start_pos(2));
+   EXPECT_EQ(12u, t.end_pos(2));
+   EXPECT_EQ(t.semantic_type(1), t.semantic_type(2));
+}
+
+TEST(FolderTest, FoldsIdentitiesButNotOverflow) {
+   using amalgam::parser::node_type;
+
+   auto m = fold("y := 3\ny * 1 + 0\n100 + 100\n");
+   ASSERT_TRUE(m != nullptr);
+
+   auto &t = trees_of(m);
+   ASSERT_EQ(3u, t.get_roots().size());
+   EXPECT_EQ(node_type::identifier, t.type(t.get_roots()[1]));
+
+   // 200 does not fit the 8 bit type of its operands.
+   EXPECT_EQ(node_type::op, t.type(t.get_roots()[2]));
+   EXPECT_EQ(2u, t.child_count(t.get_roots()[2]));
+}
+
+TEST(FolderTest, LeavesDivisionByZero) {
+   using amalgam::parser::node_type;
+
+   for (auto s : { "10 / 0\n", "10 % 0\n" }) {
+      auto m = fold(s);
+      ASSERT_TRUE(m != nullptr) << s;
+      EXPECT_EQ(node_type::op, trees_of(m).type(0)) << s;
+      EXPECT_EQ(3u, trees_of(m).size()) << s;
+   }
+
+   // Division rounds towards zero, as the generator's does.
+   auto m = fold("-7 / 2\n");
+   ASSERT_TRUE(m != nullptr);
+   ASSERT_EQ(node_type::literal_int, trees_of(m).type(0));
+   EXPECT_EQ(-3, trees_of(m).literal(0).as_signed());
+}
+
+TEST(FolderTest, FoldsShiftsWhichFit) {
+   using amalgam::parser::node_type;
+
+   auto m = fold("1 << 6\n");
+   ASSERT_TRUE(m != nullptr);
+   ASSERT_EQ(node_type::literal_int, trees_of(m).type(0));
+   EXPECT_EQ(64, trees_of(m).literal(0).as_signed());
+
+   m = fold("64 >> 2\n");
+   ASSERT_TRUE(m != nullptr);
+   ASSERT_EQ(node_type::literal_int, trees_of(m).type(0));
+   EXPECT_EQ(16, trees_of(m).literal(0).as_signed());
+
+   // 128 does not fit an int8, nor does a logical shift of a negative
+   // number, and shifting by 64 is left to the generator.
+   for (auto s : { "1 << 7\n", "-128 >> 1\n", "1 << 64\n" }) {
+      m = fold(s);
+      ASSERT_TRUE(m != nullptr) << s;
+      EXPECT_EQ(node_type::op, trees_of(m).type(0)) << s;
+   }
+}
+
+TEST(FolderTest, KeepsUnsignedResultsInRange) {
+   using amalgam::parser::node_type;
+
+   auto m = fold("0FEUh + 1Uh\n");
+   ASSERT_TRUE(m != nullptr);
+   ASSERT_EQ(node_type::literal_int, trees_of(m).type(0));
+   EXPECT_EQ(255u, trees_of(m).literal(0).bits);
+   EXPECT_FALSE(trees_of(m).literal(0).is_signed);
+
+   // 256 does not fit a uint8, and no unsigned type holds -1.
+   for (auto s : { "0FFUh + 1Uh\n", "1Uh - 2Uh\n" }) {
+      m = fold(s);
+      ASSERT_TRUE(m != nullptr) << s;
+      EXPECT_EQ(node_type::op, trees_of(m).type(0)) << s;
+   }
+}
+
+TEST(FolderTest, KeepsStatementBlocks) {
+   using amalgam::parser::node_type;
+
+   auto syntax = amalgam::parser::syntax_table_ptr_t(new amalgam::parser::syntax_table());
+   syntax->compile("statement <- if () (:)\n");
+
+   amalgam::parser::parser p(syntax);
+   auto m = p.parse("if 1 > 0: 2 + 3\n");
+   ASSERT_TRUE(m != nullptr);
+
+   auto &t = trees_of(m);
+   ASSERT_EQ(node_type::statement, t.type(0));
+   auto block = t.child(0, 1);
+   ASSERT_EQ(node_type::group, t.type(block));
+   ASSERT_EQ(1u, t.child_count(block));
+   EXPECT_EQ(node_type::literal_int, t.type(t.first_child(block)));
+   EXPECT_EQ(5, t.literal(t.first_child(block)).as_signed());
+}
+
+#endif /* TEST_FOLDER_H_ */
@@ -0,0 +1,73 @@
+/*
+ * test_helpers.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TEST_HELPERS_H_
+#define TEST_HELPERS_H_
+
+#include <cstdio>
+#include <stdexcept>
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "parser/parser.h"
+
+namespace {
+
+/** A directory of its own for the files a test writes. It is made with a
+ * unique name, so tests never see each other's files, and it is removed
+ * with everything in it when the test is done. */
+class temp_dir {
+   std::string dir;
+
+public:
+   temp_dir() {
+      char name[] = "/tmp/amalgam_test.XXXXXX";
+      if (!mkdtemp(name)) {
+         throw std::runtime_error("unable to make a temporary directory");
+      }
+
+      dir = name;
+   }
+
+   ~temp_dir() {
+      if (auto d = opendir(dir.c_str())) {
+         while (auto entry = readdir(d)) {
+            std::string n = entry->d_name;
+            if (n != "." && n != "..") {
+               std::remove(path(n).c_str());
+            }
+         }
+
+         closedir(d);
+      }
+
+      rmdir(dir.c_str());
+   }
+
+   /** Gets the directory. */
+   auto
+   get_path() const -> const std::string & {
+      return dir;
+   }
+
+   /** Gets the path of the file called name in the directory. */
+   auto
+   path(const std::string &name) const -> std::string {
+      return dir + "/" + name;
+   }
+};
+
+/** Gets the trees of the top level of m. */
+auto
+trees_of(amalgam::parser::module_ptr_t m) -> amalgam::parser::flat_tree & {
+   return m->get_method("__default__")->get_flat_tree();
+}
+
+}
+
+#endif /* TEST_HELPERS_H_ */
@@ -0,0 +1,76 @@
+/*
+ * test_lexer.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TEST_LEXER_H_
+#define TEST_LEXER_H_
+
+#include "parser/parser.h"
+#include "parser/test_helpers.h"
+
+namespace {
+
+auto
+lex_string(const std::string &s, amalgam::parser::symbol_table &symbols) -> amalgam::parser::token_array {
+   return amalgam::parser::lex(s.data(), s.data() + s.size(), symbols);
+}
+
+}
+
+TEST(LexerTest, Tokens) {
+   using amalgam::parser::token_kind;
+
+   amalgam::parser::symbol_table symbols;
+   auto t = lex_string("x1 := (10u +  y)\r\n", symbols);
+
+   ASSERT_EQ(8u, t.size());
+
+   token_kind kinds[] = { token_kind::identifier, token_kind::op, token_kind::open, token_kind::integer,
+                          token_kind::op, token_kind::identifier, token_kind::close, token_kind::eol };
+   uint64_t offsets[] = { 0, 3, 6, 7, 11, 14, 15, 16 };
+
+   for (std::size_t i = 0; i < t.size(); ++i) {
+      EXPECT_EQ(kinds[i], t.kinds[i]);
+      EXPECT_EQ(offsets[i], t.offsets[i]);
+   }
+
+   EXPECT_EQ(3u, t.lengths[3]);
+   EXPECT_EQ(2u, t.lengths[7]);
+   EXPECT_EQ(symbols.lookup("10u"), t.symbols[3]);
+   EXPECT_EQ(amalgam::parser::builtin_symbol::init, t.symbols[1]);
+   EXPECT_EQ(amalgam::parser::no_symbol, t.symbols[7]);
+   EXPECT_EQ(18u, t.end);
+}
+
+TEST(LexerTest, InvalidCharacters) {
+   amalgam::parser::symbol_table symbols;
+   auto t = lex_string("a \"b", symbols);
+
+   ASSERT_EQ(3u, t.size());
+   EXPECT_EQ(amalgam::parser::token_kind::invalid, t.kinds[1]);
+   EXPECT_EQ(2u, t.offsets[1]);
+}
+
+TEST(LexerTest, SignsBelongToLiteralsOnlyWhereOperandsGo) {
+   amalgam::parser::parser p;
+
+   auto m = p.parse_unverified("1 -5\n(-5) * +2\n");
+   ASSERT_TRUE(m != nullptr);
+
+   auto &t = trees_of(m);
+   ASSERT_EQ(2u, t.get_roots().size());
+
+   auto e = t.get_roots().front();
+   EXPECT_EQ("-", m->get_source_text(t, e));
+   EXPECT_EQ("5", m->get_source_text(t, t.child(e, 1)));
+
+   e = t.get_roots().back();
+   EXPECT_EQ("*", m->get_source_text(t, e));
+   EXPECT_EQ("-5", m->get_source_text(t, t.child(e, 0)));
+   EXPECT_EQ("+2", m->get_source_text(t, t.child(e, 1)));
+   EXPECT_EQ(m->get_symbols()->lookup("+2"), t.symbol(t.child(e, 1)));
+}
+
+#endif /* TEST_LEXER_H_ */
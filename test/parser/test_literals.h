@@ -0,0 +1,105 @@
+/*
+ * test_literals.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TEST_LITERALS_H_
+#define TEST_LITERALS_H_
+
+#include "parser/parser.h"
+
+namespace {
+
+auto
+decode(const std::string &s, amalgam::parser::literal_value &v) -> const char * {
+   return amalgam::parser::decode_int_literal(s.data(), s.size(), v);
+}
+
+}
+
+TEST(LiteralTest, DecodesBaseSignAndWidth) {
+   amalgam::parser::literal_value v;
+
+   ASSERT_EQ(nullptr, decode("-128", v));
+   EXPECT_EQ(-128, v.as_signed());
+   EXPECT_EQ(8, v.size_in_bits);
+
+   ASSERT_EQ(nullptr, decode("128", v));
+   EXPECT_EQ(16, v.size_in_bits);
+
+   ASSERT_EQ(nullptr, decode("777o", v));
+   EXPECT_EQ(511, v.as_signed());
+   EXPECT_EQ(8, v.base);
+
+   ASSERT_EQ(nullptr, decode("11111111Ub", v));
+   EXPECT_FALSE(v.is_signed);
+   EXPECT_EQ(255u, v.bits);
+   EXPECT_EQ(8, v.size_in_bits);
+
+   ASSERT_EQ(nullptr, decode("-9223372036854775808", v));
+   EXPECT_EQ(64, v.size_in_bits);
+}
+
+TEST(LiteralTest, DecodesHexadecimalDigits) {
+   amalgam::parser::literal_value v;
+
+   ASSERT_EQ(nullptr, decode("1fh", v));
+   EXPECT_EQ(31, v.as_signed());
+   EXPECT_EQ(16, v.base);
+
+   ASSERT_EQ(nullptr, decode("0ffh", v));
+   EXPECT_EQ(255, v.as_signed());
+   EXPECT_EQ(16, v.size_in_bits);
+
+   ASSERT_EQ(nullptr, decode("0FFUh", v));
+   EXPECT_FALSE(v.is_signed);
+   EXPECT_EQ(255u, v.bits);
+   EXPECT_EQ(8, v.size_in_bits);
+
+   // b ends a binary literal, but is a digit of a hexadecimal one.
+   ASSERT_EQ(nullptr, decode("1bh", v));
+   EXPECT_EQ(27, v.as_signed());
+   ASSERT_EQ(nullptr, decode("11b", v));
+   EXPECT_EQ(3, v.as_signed());
+}
+
+TEST(LiteralTest, RejectsBadLiterals) {
+   amalgam::parser::literal_value v;
+
+   EXPECT_NE(nullptr, decode("9223372036854775808", v));
+   EXPECT_NE(nullptr, decode("99999999999999999999Uh", v));
+   EXPECT_NE(nullptr, decode("12b", v));
+   EXPECT_NE(nullptr, decode("-1Uo", v));
+   EXPECT_NE(nullptr, decode("12q", v));
+   EXPECT_NE(nullptr, decode("10U", v));
+   EXPECT_NE(nullptr, decode("1f", v));
+   EXPECT_NE(nullptr, decode("ffh", v));
+   EXPECT_NE(nullptr, decode("h", v));
+   EXPECT_NE(nullptr, decode("1gh", v));
+}
+
+TEST(LiteralTest, ValueIsStoredOnTheNode) {
+   amalgam::parser::parser p;
+   auto m = p.parse("x := -5\n");
+   ASSERT_TRUE(m != nullptr);
+
+   auto &t = m->get_method("__default__")->get_flat_tree();
+   ASSERT_EQ(amalgam::parser::node_type::literal_int, t.type(2));
+   EXPECT_EQ(-5, t.literal(2).as_signed());
+   EXPECT_EQ(m->get_type_context().integer(true, 8), t.semantic_type(2));
+
+   amalgam::parser::parser q;
+   q.set_recovery(true);
+   auto bad = q.parse("y := 99999999999999999999\n");
+   ASSERT_TRUE(bad != nullptr);
+   ASSERT_EQ(1u, bad->get_diagnostics().size());
+   EXPECT_EQ("integer literal '99999999999999999999' is too large", bad->get_diagnostics()[0].message);
+
+   // Letters among the digits are part of the literal.
+   auto hex = p.parse("z := 0f1h\n");
+   ASSERT_TRUE(hex != nullptr);
+   EXPECT_EQ(241, hex->get_method("__default__")->get_flat_tree().literal(2).as_signed());
+}
+
+#endif /* TEST_LITERALS_H_ */
@@ -0,0 +1,135 @@
+/*
+ * test_memo.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TEST_MEMO_H_
+#define TEST_MEMO_H_
+
+#include "parser/lexer.h"
+
+namespace memo_test {
+
+using namespace pegtl;
+
+/** Counts how many times the innermost rule is tried. */
+struct counted : one<'a'> {
+   static unsigned attempts;
+
+   template<bool Must, typename Input, typename Debug, typename ... States>
+      static bool
+      match(Input &in, Debug &de, States && ... st) {
+         ++attempts;
+         return one<'a'>::match<Must>(in, de, std::forward<States>(st)...);
+      }
+};
+
+unsigned counted::attempts = 0;
+
+/** Without memoization each nesting level tries the group three times,
+ * which makes parsing exponential in the nesting depth. */
+template<template<typename> class Wrap>
+   struct nested {
+      struct s;
+      struct group : sor<seq<one<'('>, s, one<')'> >, counted> {};
+      struct s : sor<seq<Wrap<group>, one<'x'> >, seq<Wrap<group>, one<'y'> >, Wrap<group> > {};
+      struct grammar : seq<s, eof> {};
+   };
+
+template<typename Rule>
+   struct no_memo : Rule {};
+
+/** The same grammar over tokens, as the parser runs it. */
+template<template<typename> class Wrap>
+   struct nested_tokens {
+      typedef amalgam::parser::token_kind kind;
+
+      struct counted_token : amalgam::parser::token<kind::identifier> {
+         template<bool Must, typename Input, typename Debug, typename ... States>
+            static bool
+            match(Input &in, Debug &de, States && ... st) {
+               ++counted::attempts;
+               return amalgam::parser::token<kind::identifier>::match<Must>(in, de, std::forward<States>(st)...);
+            }
+      };
+
+      struct s;
+      struct group : sor<seq<amalgam::parser::token<kind::open>, s, amalgam::parser::token<kind::close> >,
+            counted_token> {};
+      struct s : sor<seq<Wrap<group>, amalgam::parser::token<kind::integer> >,
+            seq<Wrap<group>, amalgam::parser::token<kind::op> >, Wrap<group> > {};
+      struct grammar : seq<s, eof> {};
+   };
+
+auto
+count_attempts_for(const std::string &input, bool memoize) -> unsigned {
+   counted::attempts = 0;
+
+   memo_input<string_input<> > in(input);
+   if (memoize) {
+      dummy_parse<nested<memo>::grammar>(in);
+   } else {
+      dummy_parse<nested<no_memo>::grammar>(in);
+   }
+
+   return counted::attempts;
+}
+
+/** Tries the rule where it is optional first, and then where it is
+ * required. */
+template<template<typename> class Wrap>
+   struct optional_then_required {
+      struct grammar : seq<opt<Wrap<counted> >, must<Wrap<counted> > > {};
+   };
+
+auto
+count_token_attempts_for(const std::string &input, bool memoize) -> unsigned {
+   counted::attempts = 0;
+
+   amalgam::parser::symbol_table symbols;
+   auto tokens = amalgam::parser::lex(input.data(), input.data() + input.size(), symbols);
+
+   memo_input<amalgam::parser::token_input> in(tokens);
+   if (memoize) {
+      dummy_parse<nested_tokens<memo>::grammar>(in);
+   } else {
+      dummy_parse<nested_tokens<no_memo>::grammar>(in);
+   }
+
+   return counted::attempts;
+}
+
+}
+
+TEST(MemoTest, NestedGroupsAreLinear) {
+   std::string input = std::string(8, '(') + "a" + std::string(8, ')');
+
+   auto plain = memo_test::count_attempts_for(input, false);
+   auto memoized = memo_test::count_attempts_for(input, true);
+
+   EXPECT_EQ(19683u, plain);
+   EXPECT_EQ(1u, memoized);
+}
+
+TEST(MemoTest, NestedGroupsOverTokensAreLinear) {
+   std::string input = std::string(8, '(') + "a" + std::string(8, ')');
+
+   EXPECT_EQ(19683u, memo_test::count_token_attempts_for(input, false));
+   EXPECT_EQ(1u, memo_test::count_token_attempts_for(input, true));
+}
+
+TEST(MemoTest, FailuresAreMemoized) {
+   EXPECT_THROW(memo_test::count_attempts_for("((b))", true), pegtl::parse_error);
+}
+
+TEST(MemoTest, RequiredFailuresAreTriedAgain) {
+   memo_test::counted::attempts = 0;
+
+   pegtl::memo_input<pegtl::string_input<> > in(std::string("b"));
+   EXPECT_THROW(pegtl::dummy_parse<memo_test::optional_then_required<pegtl::memo>::grammar>(in),
+                pegtl::parse_error);
+   EXPECT_EQ(2u, memo_test::counted::attempts);
+}
+
+#endif /* TEST_MEMO_H_ */
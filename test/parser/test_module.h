@@ -9,6 +9,7 @@
 #define TEST_MODULE_H_
 
 #include "parser/module.h"
+#include "parser/parser.h"
 
 TEST(ModuleTest, CanCreate) {
    ASSERT_NO_THROW(new amalgam::parser::module("test_module"));
@@ -21,5 +22,73 @@ TEST(ModuleTest, CanGetModuleName) {
    EXPECT_EQ(m_name, m->get_name());
 }
 
+TEST(ModuleTest, CanAllocateNodes) {
+   amalgam::parser::module m("test_module");
+
+   auto a = m.make_ast();
+   auto b = m.make_ast();
+
+   EXPECT_TRUE(a != nullptr);
+   EXPECT_TRUE(a != b);
+   EXPECT_EQ(2u, m.get_ast_count());
+}
+
+TEST(ModuleTest, ParseAllocatesNodesInModule) {
+   amalgam::parser::parser p;
+   amalgam::parser::module_ptr_t m;
+
+   ASSERT_NO_THROW(m = p.parse("5+(6*10)"));
+   ASSERT_TRUE(m!=nullptr);
+   EXPECT_EQ(5u, m->get_ast_count());
+}
+
+TEST(ModuleTest, MissesDoNotInsert) {
+   amalgam::parser::module m("test_module");
+   auto symbols = m.get_symbols()->size();
+
+   EXPECT_FALSE(m.has_method("missing"));
+   EXPECT_TRUE(m.get_method("missing") == nullptr);
+   EXPECT_TRUE(m.get_type("missing") == nullptr);
+   EXPECT_EQ(1u, m.get_method_map().size());
+   EXPECT_EQ(symbols, m.get_symbols()->size());
+}
+
+TEST(ModuleTest, NestedMethodsSeeEnclosingVariables) {
+   using namespace amalgam::parser;
+   module m("test_module");
+
+   auto outer = m.get_method("__default__");
+   auto x = m.get_symbols()->intern("x");
+   outer->add_variable(x, m.get_type_context().integer(true, 8));
+
+   m.add_method(method_ptr_t(new method("inner", m.get_symbols())));
+   m.push_current_method("inner");
+
+   auto inner = m.get_current_method();
+   EXPECT_FALSE(inner->has_variable(x));
+   EXPECT_EQ(outer->get_variable(x), inner->find_variable(x));
+
+   // A variable of the inner method hides the outer one.
+   inner->add_variable(x, m.get_type_context().integer(false, 64));
+   EXPECT_EQ(m.get_type_context().integer(false, 64), inner->find_variable(x));
+
+   m.pop_current_method();
+   EXPECT_EQ(outer, m.get_current_method());
+}
+
+TEST(ModuleTest, SymbolMapKeepsOrder) {
+   amalgam::parser::symbol_map<int> map;
+
+   for (amalgam::parser::symbol_t s = 0; s < 100; ++s) {
+      map.set(99 - s, int(s));
+   }
+   map.set(50, -1);
+
+   ASSERT_EQ(100u, map.size());
+   EXPECT_EQ(-1, *map.find(50));
+   EXPECT_EQ(99u, map.begin()->first);
+   EXPECT_TRUE(map.find(100) == nullptr);
+   EXPECT_TRUE(map.find(amalgam::parser::no_symbol) == nullptr);
+}
 
 #endif /* TEST_MODULE_H_ */
@@ -8,7 +8,12 @@
 #ifndef TEST_PARSER_H_
 #define TEST_PARSER_H_
 
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
 #include "parser/parser.h"
+#include "parser/test_helpers.h"
 
 TEST(ParserTest, CanCreateParser) {
    ASSERT_NO_THROW(new amalgam::parser::parser());
@@ -74,9 +79,380 @@ TEST(ParserTest, Identifier) {
    amalgam::parser::parser p;
    amalgam::parser::module_ptr_t m;
 
-   ASSERT_NO_THROW(m = p.parse("an_ident"));
+   ASSERT_NO_THROW(m = p.parse("an_ident := 1\nan_ident"));
    EXPECT_TRUE(m!=nullptr);
 }
 
+TEST(ParserTest, NodesReferToSource) {
+   amalgam::parser::parser p;
+   amalgam::parser::module_ptr_t m;
+
+   ASSERT_NO_THROW(m = p.parse_unverified("10 + 5"));
+   ASSERT_TRUE(m!=nullptr);
+
+   auto &t = trees_of(m);
+   auto e = t.get_roots().front();
+   EXPECT_EQ("+", m->get_source_text(t, e));
+   EXPECT_EQ("10", m->get_source_text(t, t.child(e, 0)));
+   EXPECT_EQ("5", m->get_source_text(t, t.child(e, 1)));
+}
+
+TEST(ParserTest, ParseFile) {
+   temp_dir tmp;
+   auto path = tmp.path("amalgam_parser_test.am");
+   {
+      std::ofstream out(path.c_str());
+      out << "10+5\n5+(6*10)\n";
+   }
+
+   amalgam::parser::parser p;
+   amalgam::parser::module_ptr_t m;
+
+   ASSERT_NO_THROW(m = p.parse_file(path));
+   ASSERT_TRUE(m!=nullptr);
+   EXPECT_EQ("amalgam_parser_test", m->get_name());
+   EXPECT_EQ(path, m->get_path());
+   EXPECT_EQ(2u, trees_of(m).get_roots().size());
+}
+
+TEST(ParserTest, ParseFileThroughCache) {
+   temp_dir tmp;
+   std::string path = tmp.path("amalgam_cache_test.am");
+   std::string cache = path + ".cache";
+   {
+      std::ofstream out(path.c_str());
+      out << "x := 10\n5+(6*x)\n";
+   }
+
+   amalgam::parser::parser p;
+   auto parsed = p.parse_file(path);
+   ASSERT_TRUE(parsed != nullptr);
+   ASSERT_TRUE(bool(std::ifstream(cache.c_str())));
+
+   auto cached = p.parse_file(path);
+   ASSERT_TRUE(cached != nullptr);
+
+   auto &a = trees_of(parsed);
+   auto &b = trees_of(cached);
+   ASSERT_EQ(a.get_roots().size(), b.get_roots().size());
+   ASSERT_EQ(a.size(), b.size());
+
+   auto product = b.child(b.get_roots()[1], 1);
+   EXPECT_EQ(parsed->get_source_text(a, a.child(a.get_roots()[1], 1)), cached->get_source_text(b, product));
+   EXPECT_EQ(cached->get_symbols()->lookup("x"), b.symbol(b.child(product, 1)));
+   EXPECT_TRUE(cached->get_method("__default__")->has_variable("x"));
+
+   // Once the file changes, the cache is ignored.
+   {
+      std::ofstream out(path.c_str());
+      out << "7\n";
+   }
+
+   auto changed = p.parse_file(path);
+   ASSERT_TRUE(changed != nullptr);
+   EXPECT_EQ(1u, trees_of(changed).get_roots().size());
+}
+
+TEST(ParserTest, CacheRejectsImpossibleCounts) {
+   using namespace amalgam::parser;
+   temp_dir tmp;
+   std::string path = tmp.path("amalgam_corrupt.am.cache");
+   {
+      // A method which claims far more nodes than the file holds.
+      std::ofstream out(path.c_str(), std::ios::binary);
+      write_binary_header(out, "AMAC", module_cache::cache_version, 42);
+      write_binary(out, uint32_t(0));
+      write_binary(out, uint32_t(1));
+      write_binary_string(out, "__default__");
+      write_binary(out, uint32_t(0xFFFFFFFF));
+   }
+
+   module_ptr_t m(new module("corrupt"));
+   EXPECT_FALSE(module_cache::load(m, path, 42));
+}
+
+TEST(ParserTest, CacheRejectsUnknownNodeTypes) {
+   using namespace amalgam::parser;
+   temp_dir tmp;
+   std::string path = tmp.path("amalgam_bad_type.am.cache");
+   {
+      // One node, whose type is past the end of node_type.
+      std::ofstream out(path.c_str(), std::ios::binary);
+      write_binary_header(out, "AMAC", module_cache::cache_version, 42);
+      write_binary(out, uint32_t(0));
+      write_binary(out, uint32_t(1));
+      write_binary_string(out, "__default__");
+      write_binary(out, uint32_t(1));
+      write_binary(out, uint8_t(200));
+      write_binary(out, symbol_t(0));
+      write_binary(out, uint32_t(0));
+      write_binary(out, uint64_t(0));
+      write_binary(out, uint64_t(0));
+      write_binary(out, uint64_t(0));
+      write_binary(out, uint8_t(10));
+      write_binary(out, uint8_t(1));
+      write_binary(out, uint8_t(8));
+      write_binary(out, uint32_t(0));
+   }
+
+   module_ptr_t m(new module("corrupt"));
+   EXPECT_FALSE(module_cache::load(m, path, 42));
+}
+
+TEST(ParserTest, ImportThroughInterface) {
+   temp_dir tmp;
+   std::string dep = tmp.path("amalgam_import_dep.am");
+   std::string importer = tmp.path("amalgam_import_main.am");
+   {
+      std::ofstream out(dep.c_str());
+      out << "answer := 42\n";
+   }
+   {
+      std::ofstream out(importer.c_str());
+      out << "from amalgam_import_dep import answer\nanswer\n";
+   }
+
+   amalgam::parser::parser p;
+   auto m = p.parse_file(importer);
+   ASSERT_TRUE(m != nullptr);
+   EXPECT_TRUE(m->get_method("__default__")->has_variable("answer"));
+   ASSERT_TRUE(bool(std::ifstream((dep + ".interface").c_str())));
+
+   // While the dependency is unchanged, only its interface is loaded, so
+   // its cache is not written again.
+   std::remove((dep + ".cache").c_str());
+   ASSERT_TRUE(p.parse_file(importer) != nullptr);
+   EXPECT_FALSE(bool(std::ifstream((dep + ".cache").c_str())));
+
+   {
+      std::ofstream out(importer.c_str());
+      out << "from amalgam_import_dep import question\n";
+   }
+   EXPECT_TRUE(p.parse_file(importer) == nullptr);
+
+}
+
+TEST(ParserTest, ImportsSurviveTheCache) {
+   temp_dir tmp;
+   std::string dep = tmp.path("amalgam_cached_dep.am");
+   std::string importer = tmp.path("amalgam_cached_main.am");
+   {
+      std::ofstream out(dep.c_str());
+      out << "answer := 42\n";
+   }
+   {
+      std::ofstream out(importer.c_str());
+      out << "from amalgam_cached_dep import answer\ny := answer + 1\n";
+   }
+
+   // The second parser loads the importer's trees from its cache, and
+   // must still resolve its imports.
+   for (auto run = 0; run < 2; ++run) {
+      amalgam::parser::parser p;
+      auto m = p.parse_file(importer);
+      ASSERT_TRUE(m != nullptr) << run;
+      ASSERT_EQ(1u, m->get_imports().size());
+      EXPECT_EQ("amalgam_cached_dep", m->get_imports()[0].module);
+      EXPECT_TRUE(m->get_method("__default__")->has_variable("answer")) << run;
+   }
+
+}
+
+TEST(ParserTest, InterfacesFollowTheirDependencies) {
+   temp_dir tmp;
+   std::string a = tmp.path("amalgam_chain_a.am");
+   std::string b = tmp.path("amalgam_chain_b.am");
+   std::string c = tmp.path("amalgam_chain_c.am");
+
+   auto write = [](const std::string& path, const std::string& text) {
+      std::ofstream out(path.c_str());
+      out << text;
+   };
+
+   write(c, "v := 1\n");
+   write(b, "from amalgam_chain_c import v\nw := v + 1\n");
+   write(a, "x := 2\nfrom amalgam_chain_b import v\n");
+
+   {
+      amalgam::parser::parser p;
+      ASSERT_TRUE(p.parse_file(a) != nullptr);
+   }
+
+   // b is unchanged, but what it exports is not, so its interface is no
+   // longer current.
+   write(c, "u := 1\n");
+
+   std::ostringstream out;
+   auto old = std::cout.rdbuf(out.rdbuf());
+
+   amalgam::parser::parser p;
+   auto m = p.parse_file(a);
+
+   std::cout.rdbuf(old);
+
+   EXPECT_TRUE(m == nullptr);
+   EXPECT_NE(std::string::npos, out.str().find("error: " + a + ":2:1: unable to import from module 'amalgam_chain_b'"))
+      << out.str();
+
+}
+
+TEST(ParserTest, ReverifiesWhenImportsChange) {
+   temp_dir tmp;
+   std::string dep = tmp.path("amalgam_changing_dep.am");
+   std::string importer = tmp.path("amalgam_changing_main.am");
+
+   auto write = [](const std::string& path, const std::string& text) {
+      std::ofstream out(path.c_str());
+      out << text;
+   };
+
+   write(dep, "answer := 42\n");
+   write(importer, "from amalgam_changing_dep import answer\ny := answer + 1\n");
+
+   amalgam::parser::parser p;
+   ASSERT_TRUE(p.parse_file(importer) != nullptr);
+
+   // The importer is unchanged, but the type of what it imports is not.
+   write(dep, "answer := 100000\n");
+
+   auto m = p.parse_file(importer);
+   ASSERT_TRUE(m != nullptr);
+
+   auto me = m->get_method("__default__");
+   auto int32 = m->get_type_context().integer(true, 32);
+   EXPECT_EQ(int32, me->get_variable(m->get_symbols()->lookup("answer")));
+   EXPECT_EQ(int32, me->get_variable(m->get_symbols()->lookup("y")));
+
+}
+
+TEST(ParserTest, ImportCycleFails) {
+   temp_dir tmp;
+   std::string a = tmp.path("amalgam_cycle_a.am");
+   std::string b = tmp.path("amalgam_cycle_b.am");
+   {
+      std::ofstream out(a.c_str());
+      out << "from amalgam_cycle_b import y\nx := 1\n";
+   }
+   {
+      std::ofstream out(b.c_str());
+      out << "from amalgam_cycle_a import x\ny := 2\n";
+   }
+
+   amalgam::parser::parser p;
+   p.set_caching(false);
+   EXPECT_TRUE(p.parse_file(a) == nullptr);
+}
+
+TEST(ParserTest, ParseMissingFile) {
+   amalgam::parser::parser p;
+
+   EXPECT_THROW(p.parse_file("/nonexistent/file.am"), pegtl::parse_error);
+}
+
+TEST(ParserTest, ParseStream) {
+   std::istringstream in("10+5\n\n5+(6*10)\nan_ident := 1\n7");
+
+   amalgam::parser::parser p;
+   std::vector<amalgam::parser::module_ptr_t> modules;
+
+   ASSERT_NO_THROW(p.parse_stream(in, [&](amalgam::parser::module_ptr_t m) {
+      modules.push_back(m);
+   }));
+
+   ASSERT_EQ(4u, modules.size());
+   for (auto m : modules) {
+      ASSERT_TRUE(m!=nullptr);
+      EXPECT_EQ(1u, trees_of(m).get_roots().size());
+   }
+
+   EXPECT_NE(amalgam::parser::no_symbol, modules[2]->get_symbols()->lookup("an_ident"));
+}
+
+TEST(ParserTest, ParseStreamGoesOnAfterSyntaxErrors) {
+   for (auto recover : { false, true }) {
+      std::istringstream in("10+5\n(6*10\n7\n");
+
+      amalgam::parser::parser p;
+      p.set_recovery(recover);
+      std::vector<amalgam::parser::module_ptr_t> modules;
+
+      testing::internal::CaptureStdout();
+      ASSERT_NO_THROW(p.parse_stream(in, [&](amalgam::parser::module_ptr_t m) {
+         modules.push_back(m);
+      }));
+      std::string output = testing::internal::GetCapturedStdout().c_str();
+
+      ASSERT_EQ(3u, modules.size());
+      EXPECT_TRUE(modules[0] != nullptr);
+      EXPECT_TRUE(modules[1] == nullptr);
+      EXPECT_TRUE(modules[2] != nullptr);
+
+      // The position is in the stream, not in the line.
+      EXPECT_EQ(0u, output.find("error: 2:")) << output;
+   }
+}
+
+TEST(ParserTest, ProfileReportsRules) {
+   std::ostringstream report;
+
+   amalgam::parser::parser p;
+   p.set_profiling(&report);
+
+   ASSERT_TRUE(p.parse("1+2\n(3*4)\n") != nullptr);
+   EXPECT_NE(std::string::npos, report.str().find("rescanned"));
+   EXPECT_NE(std::string::npos, report.str().find("amalgam::parser::push_op"));
+}
+
+TEST(ParserTest, RecoversFromSyntaxErrors) {
+   amalgam::parser::parser p;
+   p.set_recovery(true);
+
+   auto m = p.parse("1 + 2\n1 +- 2\n3 * 4\n(5 + \nx := 7\n");
+   ASSERT_TRUE(m != nullptr);
+
+   auto &d = m->get_diagnostics();
+   ASSERT_EQ(2u, d.size());
+
+   EXPECT_EQ(2u, d[0].line);
+   EXPECT_EQ(3u, d[0].column);
+   EXPECT_NE(std::string::npos, d[0].message.find("'+-'"));
+
+   EXPECT_EQ(4u, d[1].line);
+   EXPECT_EQ(6u, d[1].column);
+
+   EXPECT_EQ(3u, trees_of(m).get_roots().size());
+}
+
+TEST(ParserTest, StopsAtFirstSyntaxErrorByDefault) {
+   amalgam::parser::parser p;
+
+   EXPECT_THROW(p.parse("1 +- 2\n(5 + \n"), pegtl::parse_error);
+}
+
+namespace profile_test {
+
+using namespace pegtl;
+
+struct word : plus<one<'a'> > {
+};
+
+struct grammar : sor<seq<word, one<'x'> >, seq<word, one<'y'> > > {
+};
+
+}
+
+TEST(ParserTest, ProfileCountsRescannedBytes) {
+   pegtl::string_input<> in("aaay");
+   pegtl::profile_debug de(pegtl::tag<profile_test::grammar>(0));
+
+   pegtl::parse<profile_test::grammar>(in, de);
+
+   auto w = de.find<profile_test::word>();
+   ASSERT_TRUE(w != nullptr);
+   EXPECT_EQ(2u, w->attempts);
+   EXPECT_EQ(2u, w->successes);
+   EXPECT_EQ(6u, w->consumed);
+   EXPECT_EQ(3u, w->rescanned);
+}
 
 #endif /* TEST_PARSER_H_ */
@@ -0,0 +1,88 @@
+/*
+ * test_runs.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TEST_RUNS_H_
+#define TEST_RUNS_H_
+
+#include <sstream>
+
+#include "parser/pegtl.hh"
+
+TEST(RunTest, ScanStopsAtFirstMiss) {
+   // Cover runs which end inside a vector, on a vector boundary, and in
+   // the scalar tail.
+   for (std::size_t length = 0; length < 80; ++length) {
+      std::string s = std::string(length, 'x') + "!" + std::string(40, 'y');
+      auto n = pegtl::scan_class<pegtl::ident2_class>(s.data(), s.data() + s.size());
+
+      EXPECT_EQ(length, n);
+   }
+}
+
+TEST(RunTest, VectorTestsAgreeWithScalarTests) {
+   // Whichever vector compares were compiled in must accept exactly the
+   // bytes the scalar test does, including those with the high bit set.
+   for (auto c = 0; c < 256; ++c) {
+      std::string s(64, char(c));
+      auto end = s.data() + s.size();
+      auto expected = [&](bool member) { return member ? s.size() : 0u; };
+
+      EXPECT_EQ(expected(pegtl::ident2_class::test(char(c))), pegtl::scan_class<pegtl::ident2_class>(s.data(), end)) << c;
+      EXPECT_EQ(expected(pegtl::digit_class::test(char(c))), pegtl::scan_class<pegtl::digit_class>(s.data(), end)) << c;
+      EXPECT_EQ(expected(pegtl::blank_class::test(char(c))), pegtl::scan_class<pegtl::blank_class>(s.data(), end)) << c;
+   }
+}
+
+TEST(RunTest, ScanStopsAtEnd) {
+   std::string s(37, '7');
+
+   EXPECT_EQ(37u, pegtl::scan_class<pegtl::digit_class>(s.data(), s.data() + s.size()));
+   EXPECT_EQ(5u, pegtl::scan_class<pegtl::digit_class>(s.data(), s.data() + 5));
+}
+
+TEST(RunTest, NonAsciiIsNeverInAClass) {
+   std::string s = std::string(20, 'a') + "\xc3\xa9" + std::string(20, 'a');
+
+   EXPECT_EQ(20u, pegtl::scan_class<pegtl::alpha_class>(s.data(), s.data() + s.size()));
+}
+
+namespace run_test {
+
+using namespace pegtl;
+
+struct grammar : seq<plus_run<ident1_class>, star_run<blank_class>, plus_run<digit_class>, eof> {
+};
+
+}
+
+TEST(RunTest, ContiguousAndBufferedInputsAgree) {
+   std::string s = "abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJ   \t   0123456789012345678901234567890";
+
+   pegtl::forward_input<const char *, pegtl::ascii_location> in(s.data(), s.data() + s.size());
+   EXPECT_TRUE(pegtl::contiguous_input<decltype(in)>::value);
+   EXPECT_NO_THROW(pegtl::basic_parse<run_test::grammar>(in));
+
+   std::istringstream stream(s);
+   typedef std::istreambuf_iterator<char> iterator_t;
+   pegtl::buffer_input<iterator_t, pegtl::offset_location> buffered((iterator_t(stream)), iterator_t());
+   EXPECT_FALSE(pegtl::contiguous_input<decltype(buffered)>::value);
+   EXPECT_NO_THROW(pegtl::basic_parse<run_test::grammar>(buffered));
+}
+
+TEST(RunTest, SkipAdvancesLocation) {
+   std::string s = "ab\ncd\nefg";
+
+   pegtl::forward_input<const char *, pegtl::ascii_location> in(s.data(), s.data() + s.size());
+   in.skip(8);
+
+   std::ostringstream where;
+   where << in.location();
+
+   EXPECT_EQ("3,3", where.str());
+   EXPECT_EQ(1u, in.remaining());
+}
+
+#endif /* TEST_RUNS_H_ */
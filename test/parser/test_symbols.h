@@ -0,0 +1,48 @@
+/*
+ * test_symbols.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TEST_SYMBOLS_H_
+#define TEST_SYMBOLS_H_
+
+#include "parser/symbols.h"
+
+TEST(SymbolTableTest, InternIsStable) {
+   amalgam::parser::symbol_table t;
+
+   auto a = t.intern("an_ident");
+   auto b = t.intern("another_ident");
+
+   EXPECT_NE(a, b);
+   EXPECT_EQ(a, t.intern("an_ident"));
+   EXPECT_EQ("an_ident", t.name(a));
+}
+
+TEST(SymbolTableTest, LookupDoesNotIntern) {
+   amalgam::parser::symbol_table t;
+   auto size = t.size();
+
+   EXPECT_EQ(amalgam::parser::no_symbol, t.lookup("missing"));
+   EXPECT_EQ(size, t.size());
+}
+
+TEST(SymbolTableTest, BuiltinsArePreinterned) {
+   amalgam::parser::symbol_table t;
+
+   EXPECT_EQ(amalgam::parser::builtin_symbol::add, t.lookup("+"));
+   EXPECT_EQ(amalgam::parser::builtin_symbol::shl, t.lookup("<<"));
+   EXPECT_EQ(amalgam::parser::builtin_symbol::init, t.lookup(":="));
+}
+
+TEST(SymbolTableTest, ParserInternsRepeatedIdentifiers) {
+   amalgam::parser::parser p;
+   amalgam::parser::module_ptr_t m;
+
+   ASSERT_NO_THROW(m = p.parse("a := 1\na+a+a"));
+   ASSERT_TRUE(m!=nullptr);
+   EXPECT_EQ(amalgam::parser::builtin_symbol::count + 2, m->get_symbols()->size());
+}
+
+#endif /* TEST_SYMBOLS_H_ */
@@ -0,0 +1,221 @@
+/*
+ * test_syntax.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TEST_SYNTAX_H_
+#define TEST_SYNTAX_H_
+
+#include <fstream>
+
+#include "parser/parser.h"
+#include "parser/test_helpers.h"
+
+namespace {
+
+const char *test_syntax =
+   "# Logical operators\n"
+   "expr 4 <- () and ()\n"
+   "expr 3 <- () or  ()\n"
+   "expr <- () if () else ()\n"
+   "\n"
+   "statement <- if () (:) {elif () (:)}* else (:)\n"
+   "statement <- if () (:)\n"
+   "statement <- while () (:)\n";
+
+/** Parses s with the test syntax and returns the root of the first tree.
+ * It is not verified, so constants are not folded. */
+auto
+parse_with_syntax(const std::string &s, amalgam::parser::module_ptr_t &m) -> amalgam::parser::node_index_t {
+   auto syntax = amalgam::parser::syntax_table_ptr_t(new amalgam::parser::syntax_table());
+   syntax->compile(test_syntax);
+
+   amalgam::parser::parser p(syntax);
+   m = p.parse_unverified(s);
+
+   if (m == nullptr || trees_of(m).get_roots().empty()) {
+      m = nullptr;
+      return 0;
+   }
+
+   return trees_of(m).get_roots().front();
+}
+
+/** Parses an if statement whose condition nests depth groups, each
+ * adding to the next, and returns how many nodes were made. */
+auto
+count_nodes_for_nested_condition(int depth) -> std::size_t {
+   std::string condition = "1";
+   for (auto i = 0; i < depth; ++i) {
+      condition = "1 + (" + condition + ")";
+   }
+
+   amalgam::parser::module_ptr_t m;
+   parse_with_syntax("if " + condition + ": 2", m);
+
+   return m == nullptr ? 0 : m->get_ast_count();
+}
+
+}
+
+TEST(SyntaxTest, CompilesDispatchTables) {
+   amalgam::parser::syntax_table t;
+   t.compile(test_syntax);
+
+   EXPECT_EQ(6u, t.get_form_count());
+
+   auto &symbols = t.get_symbols();
+   ASSERT_TRUE(t.find_statements(symbols.lookup("if")) != nullptr);
+   EXPECT_EQ(2u, t.find_statements(symbols.lookup("if"))->size());
+   EXPECT_TRUE(t.find_statements(symbols.lookup("else")) == nullptr);
+
+   EXPECT_TRUE(t.find_infix(symbols.lookup("and")) != nullptr);
+   EXPECT_TRUE(t.get_operators().is_operator(symbols.lookup("or")));
+   EXPECT_TRUE(t.is_token(symbols.lookup("elif")));
+}
+
+TEST(SyntaxTest, RejectsMalformedDeclarations) {
+   amalgam::parser::syntax_table t;
+
+   EXPECT_THROW(t.compile("expr <- and ()\n"), pegtl::parse_error);
+   EXPECT_THROW(t.compile("statement <- () (:)\n"), pegtl::parse_error);
+   EXPECT_THROW(t.compile("expression () + ()\n"), pegtl::parse_error);
+}
+
+TEST(SyntaxTest, RejectsBadPrecedences) {
+   amalgam::parser::syntax_table t;
+
+   EXPECT_THROW(t.compile("expr 5 <- () then ()\n"), pegtl::parse_error);
+   EXPECT_THROW(t.compile("expr 0 <- () then ()\n"), pegtl::parse_error);
+   EXPECT_THROW(t.compile("expr 3 <- () + ()\n"), pegtl::parse_error);
+   EXPECT_THROW(t.compile("statement 3 <- while () (:)\n"), pegtl::parse_error);
+}
+
+TEST(SyntaxTest, LastFormNeedsNoNewline) {
+   amalgam::parser::syntax_table t;
+   t.compile("# Logical operators\nexpr <- () and ()");
+
+   EXPECT_EQ(1u, t.get_form_count());
+   EXPECT_TRUE(t.find_infix(t.get_symbols().lookup("and")) != nullptr);
+}
+
+TEST(SyntaxTest, DeclaredPrecedence) {
+   amalgam::parser::module_ptr_t m;
+   auto e = parse_with_syntax("a or b and c", m);
+
+   ASSERT_TRUE(m != nullptr);
+
+   auto &t = trees_of(m);
+   EXPECT_EQ("or", m->get_source_text(t, e));
+   EXPECT_EQ("a", m->get_source_text(t, t.child(e, 0)));
+   EXPECT_EQ("and", m->get_source_text(t, t.child(e, 1)));
+}
+
+TEST(SyntaxTest, WordOperator) {
+   amalgam::parser::module_ptr_t m;
+   auto e = parse_with_syntax("1 + 2 and 3", m);
+
+   ASSERT_TRUE(m != nullptr);
+
+   auto &t = trees_of(m);
+   EXPECT_EQ("and", m->get_source_text(t, e));
+   EXPECT_EQ("+", m->get_source_text(t, t.child(e, 0)));
+   EXPECT_EQ("3", m->get_source_text(t, t.child(e, 1)));
+}
+
+TEST(SyntaxTest, OperandsInTheMiddle) {
+   amalgam::parser::module_ptr_t m;
+   auto e = parse_with_syntax("1 if 2 > 3 else 4", m);
+
+   ASSERT_TRUE(m != nullptr);
+
+   auto &t = trees_of(m);
+   ASSERT_EQ(3u, t.child_count(e));
+   EXPECT_EQ("if", m->get_source_text(t, e));
+   EXPECT_EQ("1", m->get_source_text(t, t.child(e, 0)));
+   EXPECT_EQ(">", m->get_source_text(t, t.child(e, 1)));
+   EXPECT_EQ("4", m->get_source_text(t, t.child(e, 2)));
+}
+
+TEST(SyntaxTest, Statement) {
+   amalgam::parser::module_ptr_t m;
+   auto e = parse_with_syntax("while x < 10: x := x + 1", m);
+
+   ASSERT_TRUE(m != nullptr);
+
+   auto &t = trees_of(m);
+   EXPECT_EQ(amalgam::parser::node_type::statement, t.type(e));
+   EXPECT_EQ("while", m->get_source_text(t, e));
+   ASSERT_EQ(2u, t.child_count(e));
+   EXPECT_EQ("<", m->get_source_text(t, t.child(e, 0)));
+
+   auto block = t.child(e, 1);
+   EXPECT_EQ(amalgam::parser::node_type::group, t.type(block));
+   ASSERT_EQ(1u, t.child_count(block));
+   EXPECT_EQ(":=", m->get_source_text(t, t.first_child(block)));
+}
+
+TEST(SyntaxTest, StatementFormsAreTriedInOrder) {
+   amalgam::parser::module_ptr_t m;
+
+   auto e = parse_with_syntax("if a: 1 elif b: 2 elif c: 3 else: 4", m);
+   ASSERT_TRUE(m != nullptr);
+   EXPECT_EQ(7u, trees_of(m).child_count(e));
+
+   e = parse_with_syntax("if a: 1", m);
+   ASSERT_TRUE(m != nullptr);
+   EXPECT_EQ(2u, trees_of(m).child_count(e));
+}
+
+TEST(SyntaxTest, KeywordsAreIdentifiersElsewhere) {
+   amalgam::parser::module_ptr_t m;
+   auto e = parse_with_syntax("whilst := 5", m);
+
+   ASSERT_TRUE(m != nullptr);
+
+   auto &t = trees_of(m);
+   EXPECT_EQ(amalgam::parser::node_type::op, t.type(e));
+   EXPECT_EQ("whilst", m->get_source_text(t, t.child(e, 0)));
+}
+
+TEST(SyntaxTest, LoadsDirectoryThroughCache) {
+   temp_dir tmp;
+   std::string dir = tmp.get_path();
+   std::string cache = tmp.path("syntax.cache");
+   {
+      std::ofstream out((dir + "/test.am").c_str());
+      out << test_syntax;
+   }
+
+   auto compiled = amalgam::parser::syntax_table::load_directory(dir, cache);
+   std::ifstream written(cache.c_str());
+   EXPECT_TRUE(bool(written));
+
+   auto cached = amalgam::parser::syntax_table::load_directory(dir, cache);
+   EXPECT_EQ(compiled->get_form_count(), cached->get_form_count());
+   EXPECT_EQ(compiled->get_symbols().size(), cached->get_symbols().size());
+
+   auto sym = cached->get_symbols().lookup("or");
+   EXPECT_EQ(compiled->get_symbols().lookup("or"), sym);
+   EXPECT_TRUE(cached->find_infix(sym) != nullptr);
+   EXPECT_TRUE(cached->get_operators().is_operator(sym));
+
+   amalgam::parser::parser p(cached);
+   auto m = p.parse("if a: 1 else: 2");
+   ASSERT_TRUE(m != nullptr);
+   EXPECT_EQ(amalgam::parser::node_type::statement, trees_of(m).type(0));
+}
+
+TEST(SyntaxTest, NestedGroupsAreBuiltOnce) {
+   // Both forms of if parse the condition, but memo<> replays the tree
+   // the first one built, so each level of nesting only adds its own two
+   // nodes, however many forms are tried.
+   auto shallow = count_nodes_for_nested_condition(8);
+   auto deep = count_nodes_for_nested_condition(16);
+
+   ASSERT_NE(0u, shallow);
+   EXPECT_EQ(16u, deep - shallow);
+}
+
+#endif /* TEST_SYNTAX_H_ */
@@ -8,8 +8,79 @@
 #ifndef TEST_VERIFIER_H_
 #define TEST_VERIFIER_H_
 
+#include <sstream>
+
 #include "parser/verifier.h"
 
+namespace {
+
+/** Makes an identifier or literal node. */
+auto
+leaf(amalgam::parser::module_ptr_t m, amalgam::parser::node_type type, const std::string &text)
+      -> amalgam::parser::ast_ptr_t {
+   auto n = m->make_ast();
+   n->type = type;
+   n->symbol = m->get_symbols()->intern(text);
+
+   if (type == amalgam::parser::node_type::literal_int) {
+      amalgam::parser::decode_int_literal(text.data(), text.size(), n->literal);
+   }
+
+   return n;
+}
+
+/** Makes an operator node. */
+auto
+binary(amalgam::parser::module_ptr_t m, amalgam::parser::symbol_t op, amalgam::parser::ast_ptr_t l,
+       amalgam::parser::ast_ptr_t r) -> amalgam::parser::ast_ptr_t {
+   auto n = m->make_ast();
+   n->type = amalgam::parser::node_type::op;
+   n->symbol = op;
+   n->children.push_back(l);
+   n->children.push_back(r);
+
+   return n;
+}
+
+/** Adds a method holding one tree. */
+void
+add_method(amalgam::parser::module_ptr_t m, const std::string &name, amalgam::parser::ast_ptr_t tree) {
+   amalgam::parser::method_ptr_t me(new amalgam::parser::method(name, m->get_symbols()));
+   me->add_expression_tree(tree);
+   m->add_method(me);
+}
+
+/** Builds a module with count methods which each initialize v from a
+ * literal, except that every tenth one initializes it from an unknown
+ * variable instead. */
+auto
+many_methods(int count) -> amalgam::parser::module_ptr_t {
+   using namespace amalgam::parser;
+
+   module_ptr_t m(new module("many"));
+
+   for (auto i = 0; i < count; ++i) {
+      auto r = (i % 10 == 0) ? leaf(m, node_type::identifier, "w") : leaf(m, node_type::literal_int, "7");
+      add_method(m, "m" + std::to_string(i), binary(m, builtin_symbol::init, leaf(m, node_type::identifier, "v"), r));
+   }
+
+   return m;
+}
+
+/** Verifies m, and returns what the verifier printed. */
+auto
+verify_output(amalgam::parser::module_ptr_t m, unsigned threads, bool &passed) -> std::string {
+   std::ostringstream out;
+   auto old = std::cout.rdbuf(out.rdbuf());
+
+   passed = amalgam::parser::verifier(threads).verify(m);
+
+   std::cout.rdbuf(old);
+   return out.str();
+}
+
+}
+
 TEST(VerifierTest, CanCreate) {
    ASSERT_NO_THROW(new amalgam::parser::verifier());
 }
@@ -23,5 +94,190 @@ TEST(VerifierTest, Identifier) {
    EXPECT_TRUE(m->get_method("__default__")->has_variable("an_ident"));
 }
 
+TEST(VerifierTest, EqualTypesAreOneAnnotation) {
+   amalgam::parser::parser p;
+   auto m = p.parse("x := 10 + 5\ny := 7\nz := 1000\n");
+   ASSERT_TRUE(m != nullptr);
+
+   auto me = m->get_method("__default__");
+   auto int8 = m->get_type_context().integer(true, 8);
+   EXPECT_EQ(int8, me->get_variable(m->get_symbols()->lookup("x")));
+   EXPECT_EQ(int8, me->get_variable(m->get_symbols()->lookup("y")));
+   EXPECT_EQ(m->get_type_context().integer(true, 16), me->get_variable(m->get_symbols()->lookup("z")));
+}
+
+TEST(VerifierTest, InternsStructurally) {
+   using namespace amalgam::parser;
+   type_context types;
+
+   auto make_pair = [&]() {
+      auto t = new composite_type_annotation(type_annotation::type_id::tuple);
+      t->children.reset(new type_annotation::list_t());
+      t->children->push_back(type_annotation::ptr_t(new numeric_type_annotation(type_annotation::type_id::integer)));
+      t->children->push_back(types.integer(false, 32));
+      return type_annotation::ptr_t(t);
+   };
+
+   auto a = types.intern(make_pair());
+   auto b = types.intern(make_pair());
+   EXPECT_EQ(a, b);
+   EXPECT_NE(a, types.intern(type_annotation::ptr_t(new type_annotation(type_annotation::type_id::string))));
+}
+
+TEST(VerifierTest, ParallelMatchesSerial) {
+   auto serial = many_methods(500);
+   auto parallel = many_methods(500);
+
+   bool serial_passed, parallel_passed;
+   auto expected = verify_output(serial, 1, serial_passed);
+   auto actual = verify_output(parallel, 4, parallel_passed);
+
+   EXPECT_FALSE(serial_passed);
+   EXPECT_FALSE(parallel_passed);
+   EXPECT_EQ(expected, actual);
+
+   for (auto &it : parallel->get_method_map()) {
+      auto &name = it.second->get_name();
+      if (name == "__default__") {
+         continue;
+      }
+
+      auto index = std::stoi(name.substr(1));
+      EXPECT_EQ(index % 10 != 0, it.second->has_variable("v")) << name;
+   }
+}
+
+TEST(VerifierTest, ReverifiesOnlyWhatChanged) {
+   using namespace amalgam::parser;
+   verification_cache cache;
+
+   // A module which declares w, twenty methods which declare v, and one
+   // which reads w.
+   auto build = [&](const std::string &w, const std::string &changed) {
+      module_ptr_t m(new module("inc", "inc.am", nullptr, cache.get_type_context("inc.am")));
+
+      auto declare = binary(m, builtin_symbol::init, leaf(m, node_type::identifier, "w"),
+                            leaf(m, node_type::literal_int, w));
+      m->get_method("__default__")->add_expression_tree(declare);
+
+      for (auto i = 0; i < 20; ++i) {
+         auto value = leaf(m, node_type::literal_int, i == 3 ? changed : "7");
+         add_method(m, "m" + std::to_string(i), binary(m, builtin_symbol::init, leaf(m, node_type::identifier, "v"), value));
+      }
+
+      add_method(m, "reader", binary(m, builtin_symbol::add, leaf(m, node_type::identifier, "w"),
+                                     leaf(m, node_type::literal_int, "1")));
+      return m;
+   };
+
+   auto reused = [&](module_ptr_t m) {
+      verifier v;
+      v.set_cache(&cache);
+      EXPECT_TRUE(v.verify(m));
+      return v.get_reused();
+   };
+
+   EXPECT_EQ(0u, reused(build("5", "7")));
+
+   auto same = build("5", "7");
+   EXPECT_EQ(22u, reused(same));
+   EXPECT_TRUE(same->get_method("m0")->has_variable("v"));
+   EXPECT_EQ(cache.get_type_context("inc.am")->integer(true, 8),
+             same->get_method("m0")->get_flat_tree().semantic_type(1));
+
+   // Only the method which changed is verified again.
+   EXPECT_EQ(21u, reused(build("5", "300")));
+
+   // Changing the type of w changes __default__, and the method which
+   // reads w, but none of the others.
+   EXPECT_EQ(20u, reused(build("500", "300")));
+}
+
+TEST(VerifierTest, InfersFromOperandsAndVariables) {
+   using namespace amalgam::parser;
+   parser p;
+
+   auto m = p.parse_unverified("x := 7Uo\ny := x + 1\nz := 10 + 300\nw := y * (2 - x)\n");
+   ASSERT_TRUE(m != nullptr);
+
+   bool passed;
+   EXPECT_EQ("", verify_output(m, 1, passed));
+   EXPECT_TRUE(passed);
+
+   auto me = m->get_method("__default__");
+   auto& types = m->get_type_context();
+   auto var = [&](const std::string& name) {
+      return me->get_variable(m->get_symbols()->lookup(name));
+   };
+
+   // Literals take the type of what they are used with, and widen to hold
+   // each other.
+   EXPECT_EQ(types.integer(false, 8), var("y"));
+   EXPECT_EQ(types.integer(false, 8), var("w"));
+   EXPECT_EQ(types.integer(true, 16), var("z"));
+
+   auto& t = me->get_flat_tree();
+   auto ten = t.first_child(t.next_sibling(t.first_child(t.get_roots()[2])));
+   ASSERT_EQ(node_type::literal_int, t.type(ten));
+   EXPECT_EQ(types.integer(true, 16), t.semantic_type(ten));
+}
+
+TEST(VerifierTest, ReportsMismatchedOperands) {
+   amalgam::parser::parser p;
+   bool passed;
+
+   auto m = p.parse_unverified("x := 7Uo\ny := -3\nz := x + y\n");
+   ASSERT_TRUE(m != nullptr);
+   EXPECT_EQ("error: the operands of '+' have different types: uint8 and int8\n", verify_output(m, 1, passed));
+   EXPECT_FALSE(passed);
+
+   m = p.parse_unverified("x := 7Uo\ny := x - -1\n");
+   ASSERT_TRUE(m != nullptr);
+   EXPECT_EQ("error: the operands of '-' have different types: uint8 and an integer literal\n",
+             verify_output(m, 1, passed));
+   EXPECT_FALSE(passed);
+}
+
+TEST(VerifierTest, ReportsUnknownVariables) {
+   amalgam::parser::parser p;
+   bool passed;
+
+   auto m = p.parse_unverified("y := zzz + 1 + zzz * qq\n");
+   ASSERT_TRUE(m != nullptr);
+   EXPECT_EQ("error: unknown variable 'zzz'\nerror: unknown variable 'qq'\n", verify_output(m, 1, passed));
+   EXPECT_FALSE(passed);
+   EXPECT_FALSE(m->get_method("__default__")->has_variable("y"));
+}
+
+TEST(VerifierTest, VerifiesEnclosingMethodsFirst) {
+   using namespace amalgam::parser;
+   module_ptr_t m(new module("nested"));
+
+   // The inner methods are added first, so they come first in the module,
+   // but they use the variable their enclosing method declares.
+   for (auto i = 0; i < 100; ++i) {
+      add_method(m, "i" + std::to_string(i),
+                 binary(m, builtin_symbol::init, leaf(m, node_type::identifier, "w"),
+                        leaf(m, node_type::identifier, "v")));
+   }
+
+   add_method(m, "outer", binary(m, builtin_symbol::init, leaf(m, node_type::identifier, "v"),
+                                 leaf(m, node_type::literal_int, "7")));
+
+   auto outer = m->get_method("outer");
+   for (auto i = 0; i < 100; ++i) {
+      m->get_method("i" + std::to_string(i))->set_enclosing(outer.get());
+   }
+
+   bool passed;
+   EXPECT_EQ("", verify_output(m, 4, passed));
+   EXPECT_TRUE(passed);
+
+   auto v = m->get_symbols()->intern("v");
+   auto w = m->get_symbols()->intern("w");
+   for (auto i = 0; i < 100; ++i) {
+      EXPECT_EQ(outer->get_variable(v), m->get_method("i" + std::to_string(i))->get_variable(w));
+   }
+}
 
 #endif /* TEST_VERIFIER_H_ */